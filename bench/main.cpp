@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "log.h"
+#include "logtofile.h"
+#ifdef __linux__
+#include "logtoasyncfile.h"
+#endif
+
+/** @brief compares the throughput of the file outputs. Each run logs the messages from one thread, waiting for the Manager thread to catch up
+*   every so often so that no messages are dropped, and reports how long it took for all of them to reach the file.
+*   With --startup it instead measures how long Init takes and how long the statements of a burst logged straight afterwards take, as a program's start up
+*   burst would be. The library can only be set up once per process so run it once with a queue capacity of 0 and once with one big enough for the burst.
+*   With --latency it measures how long each message takes from the statement to the output, with a pause between messages so the Manager thread goes idle, for
+*   ConsumerMode::kBlocking or kBusyPoll.
+*   With --threads it measures the throughput of 1, 2, 4... threads logging at once with the given number of shards (see Config::nShards)
+**/
+
+namespace
+{
+    void Run(const std::string& sName, std::unique_ptr<pml::log::Output> pOutput, size_t nMessages)
+    {
+        auto nId = pml::log::Stream::AddOutput(std::move(pOutput));
+
+        auto start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < nMessages; i++)
+        {
+            pml::log::info("bench").format(PML_LOG_FMT("message {} of {} with some padding to make it a typical length"), i, nMessages);
+            if(i % 4096 == 4095)
+            {
+                pml::log::Stream::FlushAll();
+            }
+        }
+        pml::log::Stream::FlushAll(std::chrono::milliseconds(60000));
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now()-start;
+
+        pml::log::Stream::RemoveOutput(nId);
+        std::cout << sName << "\t" << nMessages << " messages in " << elapsed.count() << "s\t" << static_cast<size_t>(nMessages/elapsed.count()) << " messages/s" << std::endl;
+    }
+
+    /** @brief an output that throws the messages away so that only the library itself is measured
+    **/
+    class Discard : public pml::log::Output
+    {
+        public:
+            Discard() : Output(kTsNone){}
+        private:
+            void DoOutputMessage(pml::log::Level, const std::string&, const std::string&) override {}
+            void Flush() override {}
+    };
+
+    /** @brief an output that counts the messages so that the number dropped can be reported
+    **/
+    class Count : public pml::log::Output
+    {
+        public:
+            Count() : Output(kTsNone){}
+            size_t Get() const { return m_nMessages; }
+        private:
+            void DoOutputMessage(pml::log::Level, const std::string&, const std::string&) override { ++m_nMessages; }
+            void Flush() override {}
+
+            size_t m_nMessages = 0;     ///< only read once FlushAll has returned
+    };
+
+    /** @brief an output that works out how long ago each message, which is the steady_clock time it was logged at, was logged
+    **/
+    class Latency : public pml::log::Output
+    {
+        public:
+            explicit Latency(size_t nMessages) : Output(kTsNone) { m_vLatency.reserve(nMessages); }
+            std::vector<int64_t>& GetLatency() { return m_vLatency; }
+        private:
+            void DoOutputMessage(pml::log::Level, const std::string& sLog, const std::string&) override
+            {
+                auto nNow = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+                m_vLatency.push_back(nNow-std::stoll(sLog));
+            }
+            void Flush() override {}
+
+            std::vector<int64_t> m_vLatency;
+    };
+
+    int EndToEnd(pml::log::ConsumerMode mode, size_t nMessages)
+    {
+        using namespace std::chrono;
+
+        auto pLatency = std::make_unique<Latency>(nMessages);
+        auto& vLatency = pLatency->GetLatency();
+        pml::log::Config config;
+        config.consumer = mode;
+        config.vOutputs.push_back(std::move(pLatency));
+        pml::log::Init(std::move(config));
+
+        for(size_t i = 0; i < nMessages; i++)
+        {
+            pml::log::info("bench") << duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+            std::this_thread::sleep_for(microseconds(200));
+        }
+        pml::log::Stream::FlushAll(milliseconds(60000));
+        pml::log::Stream::Stop();
+
+        if(vLatency.empty())
+        {
+            return 1;
+        }
+        std::sort(vLatency.begin(), vLatency.end());
+        auto percentile = [&vLatency](double dPercent){ return vLatency[static_cast<size_t>(dPercent*(vLatency.size()-1))]/1000.0; };
+        std::cout << (mode == pml::log::ConsumerMode::kBusyPoll ? "Busy poll" : "Blocking") << "\t" << vLatency.size() << " messages\tlatency us: median " << percentile(0.5)
+                  << " p99 " << percentile(0.99) << " max " << percentile(1.0) << std::endl;
+        return 0;
+    }
+
+    int Threads(size_t nShards, size_t nMaxThreads, size_t nMessages)
+    {
+        using namespace std::chrono;
+
+        //each thread waits for its messages to be output every so often, so this is enough that the queues never run out of space
+        static constexpr size_t kWaitEvery = 128;
+        auto pCount = std::make_unique<Count>();
+        auto& count = *pCount;
+        pml::log::Config config;
+        config.nShards = nShards;
+        config.nQueueCapacity = std::max<size_t>(1, nMaxThreads/std::max<size_t>(nShards, 1))*(kWaitEvery+64);
+        config.vOutputs.push_back(std::move(pCount));
+        pml::log::Init(std::move(config));
+
+        for(size_t nThreads = 1; nThreads <= nMaxThreads; nThreads *= 2)
+        {
+            auto nBefore = count.Get();
+            auto nPerThread = nMessages/nThreads;
+            auto start = steady_clock::now();
+
+            std::vector<std::thread> vThreads;
+            for(size_t nThread = 0; nThread < nThreads; nThread++)
+            {
+                vThreads.emplace_back([nThread, nPerThread]{
+                    for(size_t i = 0; i < nPerThread; i++)
+                    {
+                        pml::log::info("bench").format(PML_LOG_FMT("thread {} message {}"), nThread, i);
+                        if(i % kWaitEvery == kWaitEvery-1)
+                        {
+                            pml::log::Stream::WaitUntilDurable();
+                        }
+                    }
+                });
+            }
+            for(auto& th : vThreads)
+            {
+                th.join();
+            }
+            pml::log::Stream::FlushAll(milliseconds(60000));
+            duration<double> elapsed = steady_clock::now()-start;
+
+            auto nSent = nPerThread*nThreads;
+            auto nOutput = count.Get()-nBefore;
+            std::cout << "Shards " << nShards << "\tthreads " << nThreads << "\t" << nSent << " messages in " << elapsed.count() << "s\t"
+                      << static_cast<size_t>(nOutput/elapsed.count()) << " messages/s\tdropped " << (nSent-nOutput) << std::endl;
+        }
+        pml::log::Stream::Stop();
+        return 0;
+    }
+
+    int Startup(size_t nQueueCapacity, size_t nMessages)
+    {
+        using namespace std::chrono;
+
+        auto start = steady_clock::now();
+        pml::log::Config config;
+        config.nQueueCapacity = nQueueCapacity;
+        config.vOutputs.push_back(std::make_unique<Discard>());
+        pml::log::Init(std::move(config));
+        auto init = steady_clock::now();
+
+        nanoseconds longest(0);
+        for(size_t i = 0; i < nMessages; i++)
+        {
+            auto before = steady_clock::now();
+            pml::log::info("bench").format(PML_LOG_FMT("startup message {}"), i);
+            longest = std::max(longest, duration_cast<nanoseconds>(steady_clock::now()-before));
+        }
+        auto logged = steady_clock::now();
+        pml::log::Stream::FlushAll(milliseconds(60000));
+        auto output = steady_clock::now();
+
+        std::cout << "Queue capacity " << nQueueCapacity << "\tInit " << duration_cast<microseconds>(init-start).count() << "us"
+                  << "\tburst of " << nMessages << ": mean " << duration_cast<nanoseconds>(logged-init).count()/std::max(nMessages, size_t(1)) << "ns"
+                  << " max " << longest.count() << "ns per statement"
+                  << "\tall output after " << duration_cast<microseconds>(output-start).count() << "us" << std::endl;
+
+        pml::log::Stream::Stop();
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc > 1 && std::strcmp(argv[1], "--startup") == 0)
+    {
+        return Startup(argc > 2 ? std::stoul(argv[2]) : 0, argc > 3 ? std::stoul(argv[3]) : 10000);
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--latency") == 0)
+    {
+        auto mode = (argc > 2 && std::strcmp(argv[2], "busy") == 0) ? pml::log::ConsumerMode::kBusyPoll : pml::log::ConsumerMode::kBlocking;
+        return EndToEnd(mode, argc > 3 ? std::stoul(argv[3]) : 10000);
+    }
+
+    if(argc > 1 && std::strcmp(argv[1], "--threads") == 0)
+    {
+        return Threads(argc > 2 ? std::stoul(argv[2]) : 1, argc > 3 ? std::stoul(argv[3]) : 64, argc > 4 ? std::stoul(argv[4]) : 1000000);
+    }
+
+    size_t nMessages = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    std::filesystem::path root = argc > 2 ? argv[2] : std::filesystem::temp_directory_path()/"pml_log_bench";
+
+    std::filesystem::remove_all(root);
+    Run("File", std::make_unique<pml::log::File>(root/"file"), nMessages);
+#ifdef __linux__
+    auto pAsync = std::make_unique<pml::log::AsyncFile>(root/"async");
+    auto sName = pAsync->IsUsingIoUring() ? "AsyncFile (io_uring)" : "AsyncFile (pwrite)";
+    Run(sName, std::move(pAsync), nMessages);
+#endif
+    std::filesystem::remove_all(root);
+
+    pml::log::Stream::Stop();
+    return 0;
+}
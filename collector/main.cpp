@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "logcollector.h"
+#include "logtofile.h"
+
+/** @brief pml_log_collector reads the shared memory rings of every process on the host that logs to a pml::log::SharedMemory output with the given channel
+*   and writes their messages, merged in time order, to one set of hourly log files
+**/
+
+namespace
+{
+    std::atomic_bool g_bRun{true};
+
+    void Stop(int)
+    {
+        g_bRun = false;
+    }
+
+    void Usage()
+    {
+        std::cerr << "Usage: pml_log_collector [options] <log directory>\n"
+                  << "  --channel <name>    the channel the processes log to. Defaults to default\n"
+                  << "  --window <ms>       how long to wait for a slower process to keep the messages in time order. Defaults to 100\n"
+                  << "  --console           also write the messages to stdout\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string sChannel("default");
+    std::string sPath;
+    int nWindow = 100;
+    bool bConsole = false;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string sArg(argv[i]);
+        bool bValue = i+1 < argc;
+        if(sArg == "--channel" && bValue)       sChannel = argv[++i];
+        else if(sArg == "--window" && bValue)   nWindow = std::max(0, std::atoi(argv[++i]));
+        else if(sArg == "--console")            bConsole = true;
+        else if(sArg.empty() == false && sArg[0] != '-' && sPath.empty())
+        {
+            sPath = sArg;
+        }
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+
+    if(sPath.empty() || sChannel.empty() || sChannel.find('/') != std::string::npos)
+    {
+        Usage();
+        return 1;
+    }
+
+    pml::log::Collector collector(sChannel, std::chrono::milliseconds(nWindow));
+    collector.AddOutput(std::make_unique<pml::log::File>(sPath, pml::log::Output::kTsDate | pml::log::Output::kTsTime, pml::log::Output::TS::kMicrosecond));
+    if(bConsole)
+    {
+        collector.AddOutput(std::make_unique<pml::log::Output>());
+    }
+
+    std::signal(SIGINT, Stop);
+    std::signal(SIGTERM, Stop);
+    collector.Run(g_bRun);
+    return 0;
+}
@@ -2,15 +2,26 @@
 #define PML_LOG_LOG_H
 
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <memory>
+#include <atomic>
+#include <cstdint>
 #include <map>
+#include <optional>
 #include <thread>
+#include <type_traits>
 #include <mutex>
+#include <vector>
 
 #include "dlllog.h"
+#include "logbuffer.h"
+#include "logcontext.h"
+#include "logformat.h"
 
 namespace pml
 {
@@ -25,6 +36,7 @@ namespace pml
         LOG_EXPORT const char* GetGitBranch();
 
         class Stream;
+        class Logger;
 
         /**
          * @brief the log level
@@ -32,6 +44,61 @@ namespace pml
          */
         enum class Level{ kTrace, kDebug, kInfo, kWarning, kError, kCritical };
 
+        /** @brief How far an Output must take a message before a thread waiting in Stream::WaitUntilDurable is released
+        **/
+        enum class Durability
+        {
+            kNone,      ///< the Output writes the message when it chooses
+            kFlush,     ///< the Output's buffers are handed to the kernel at the end of the batch the message is in
+            kSync       ///< as kFlush and then the data is synced to stable storage. One sync covers every message in the batch
+        };
+
+        /** @brief How the threads that the library creates should be scheduled. Only applied on Linux
+        **/
+        struct ThreadConfig
+        {
+            enum class Policy { kDefault, kBatch, kIdle };  ///< SCHED_OTHER, SCHED_BATCH or SCHED_IDLE
+
+            std::vector<int> vCpus;             ///< the CPUs the threads may run on. Left alone if empty
+            Policy policy = Policy::kDefault;   ///< the scheduling policy. Left alone if kDefault
+            std::optional<int> nice;            ///< the nice value. Left alone if not set
+            std::string sName = "pml_log";      ///< the thread name shown in top/perf. Truncated to 15 characters
+        };
+
+        /** @brief Applies the current ThreadConfig to the calling thread. Outputs that start their own worker threads should call this at the start of each thread
+        *   @param sName the name to give the thread. If empty the name from the ThreadConfig is used
+        **/
+        LOG_EXPORT void ApplyThreadConfig(const std::string& sName="");
+
+        /** @brief A handle to an interned prefix. The name is registered once and messages carry the small integer id instead of a copy of the string.
+        *   Create them once and keep them e.g. <i>static const pml::log::Prefix kNet("net");</i>
+        **/
+        class LOG_EXPORT Prefix
+        {
+            public:
+                static constexpr uint16_t kMaxPrefixes = 4096;      ///< the maximum number of prefixes that can be registered
+                static constexpr uint16_t kUnregistered = 0xFFFF;   ///< the id used once the registry is full. The name is then carried with each message
+
+                /** @brief Constructor - registers the name if it has not already been registered
+                *   @param sName the prefix
+                **/
+                explicit Prefix(const std::string& sName);
+
+                /** @brief Gets the id of the prefix
+                *   @return <i>uint16_t</i> the id or kUnregistered
+                **/
+                uint16_t GetId() const { return m_nId; }
+
+                /** @brief Gets the name of the prefix
+                *   @return <i>std::string</i> the name
+                **/
+                const std::string& GetName() const;
+
+            private:
+                uint16_t m_nId;
+                std::string m_sName;    ///< only set if the registry was full
+        };
+
         /** @brief helper function to easily access a LogStream. Usage is pml::log::log() << "this is a message";
         *   @param level the message level
         *   @return <i>LogStream</i>
@@ -67,7 +134,30 @@ namespace pml
         *   @return <i>LogStream</i>
         **/
         LOG_EXPORT Stream critical(const std::string& sPrefix = "");
-    
+
+        /** @brief helper functions that take an interned Prefix rather than a string. Usage is pml::log::info(kNet) << "this is a message";
+        *   @param prefix the prefix
+        *   @return <i>LogStream</i>
+        **/
+        LOG_EXPORT Stream log(Level level, const Prefix& prefix);
+        LOG_EXPORT Stream trace(const Prefix& prefix);
+        LOG_EXPORT Stream debug(const Prefix& prefix);
+        LOG_EXPORT Stream info(const Prefix& prefix);
+        LOG_EXPORT Stream warning(const Prefix& prefix);
+        LOG_EXPORT Stream error(const Prefix& prefix);
+        LOG_EXPORT Stream critical(const Prefix& prefix);
+
+        namespace detail
+        {
+            class Renderer;
+
+            LOG_EXPORT extern std::atomic<int> g_nFloorLevel;   ///< the lowest level that any output will accept for any prefix. Kept up to date by the Manager
+
+            /** @brief most disabled messages are below the level of every output for every prefix, so this one load is enough to reject them
+            **/
+            inline bool IsAboveFloor(Level level) { return static_cast<int>(level) >= g_nFloorLevel.load(std::memory_order_relaxed); }
+        }
+
         /** @brief The Output class - the default class writes the log to the console, derive your own class from this to write the log elsewhere
         **/
         class LOG_EXPORT Output
@@ -85,7 +175,7 @@ namespace pml
                 *   @param nTimestamp the format of the time message to write for each log message. Can be TS_NONE (no message), TS_DATE (yyyy-mm-dd) and/or TS_TIME (hh:mm:ss)
                 *   @param eResolution the resolution of the timestamp message if TS_TIME is set
                 **/
-                Output(int nTimestamp=kTsTime, TS resolution=TS::kMillisecond) : m_level(Level::kTrace), m_nTimestamp(nTimestamp), m_resolution(resolution){}
+                Output(int nTimestamp=kTsTime, TS resolution=TS::kMillisecond) : m_level(Level::kTrace), m_nTimestamp(nTimestamp), m_resolution(resolution), m_pPrefixLevels(new std::atomic<int8_t>[Prefix::kMaxPrefixes]()){}
                 
                 /**
                  * @brief Destroy the Output object
@@ -95,7 +185,8 @@ namespace pml
 
                 
 
-                /** @brief Sets the level that a log message must meet to be output by the LogOutput
+                /** @brief Sets the level that a log message must meet to be output by the LogOutput.
+                *   Once the Output has been added use Stream::SetOutputLevel instead, which publishes the new level to the Manager
                 *   @param eLevel the level
                 **/
                 void SetOutputLevel(Level level);
@@ -105,11 +196,47 @@ namespace pml
                 **/
                 Level GetOutputLevel() const;
 
+                /** @brief Sets the level that a log message with the given prefix must meet to be output by the LogOutput, overriding the output level for that prefix.
+                *   Once the Output has been added use Stream::SetOutputLevel instead, which publishes the new level to the Manager
+                *   @param prefix the prefix
+                *   @param level the level
+                **/
+                void SetPrefixLevel(const Prefix& prefix, Level level);
+
+                /** @brief Removes the level set for the given prefix so that its messages must meet the output level again
+                *   @param prefix the prefix
+                **/
+                void ClearPrefixLevel(const Prefix& prefix);
+
+                /** @brief Gets the level that a log message with the given prefix must meet to be output by the LogOutput
+                *   @param prefix the prefix
+                *   @return the level
+                **/
+                Level GetOutputLevel(const Prefix& prefix) const;
+
+                /** @brief Sets the durability of messages of every level
+                *   @param durability the durability
+                **/
+                void SetDurability(Durability durability);
+
+                /** @brief Sets the durability of messages of the given level
+                *   @param level the level
+                *   @param durability the durability
+                **/
+                void SetDurability(Level level, Durability durability);
+
+                /** @brief Gets the durability of messages of the given level
+                *   @param level the level
+                *   @return the durability
+                **/
+                Durability GetDurability(Level level) const;
+
 
             protected:
                 friend class Manager;
+                friend class Collector;
                 
-                /** @brief Virtual function that should output the message to the desired location
+                /** @brief Virtual function that should output the message to the desired location. The Manager has already checked the level of the message against the output and prefix levels
                 *   @param eLogLevel the level of the current message
                 *   @param sLog the current message
                 *   @param sPrefix the prefix of the current message 
@@ -121,26 +248,126 @@ namespace pml
                 **/
                 virtual void Flush();
 
-                /** @brief Called by the LogManager to output a message from the stream
+                /** @brief Virtual function that is called after Flush at the end of a batch that contained messages whose level has a durability other than kNone.
+                *   Outputs that buffer or write asynchronously should override it to wait for their writes and, for kSync, sync them to storage. The default does nothing
+                *   @param durability the highest durability of the messages in the batch
+                *   @return <i>bool</i> false if the messages could not all be committed, in which case the threads waiting for them in Stream::WaitUntilDurable are told so
+                **/
+                virtual bool Commit(Durability durability);
+
+                /** @brief Called by the LogManager to output a message from the stream. The caller has already checked the message's level against the output's levels
                 *   @param eLogLevel the level of the current message
                 *   @param sLog the current message
                 *   @param sPrefix the prefix of the current message 
+                *   @param pContext the diagnostic context of the thread that logged the message, if any
+                *   @param pRenderer renders the line for the message once for all the outputs that share a timestamp format
+                **/
+                void OutputMessage(Level level, const std::string&  sLog, const std::string& sPrefix, const Context* pContext, detail::Renderer* pRenderer)
+                {
+                    m_pContext = pContext;
+                    m_pRenderer = pRenderer;
+                    DoOutputMessage(level, sLog, sPrefix);
+                    m_pContext = nullptr;
+                    m_pRenderer = nullptr;
+                    m_batchDurability = std::max(m_batchDurability, m_aDurability[static_cast<int>(level)].load(std::memory_order_relaxed));
+                }
+
+                /** @brief Checks a message level against the level set for its prefix or, if there is none, the output level
                 **/
-                void OutputMessage(Level level, const std::string&  sLog, const std::string& sPrefix) {DoOutputMessage(level, sLog, sPrefix);}
+                bool Accepts(Level level, uint16_t nPrefix) const
+                {
+                    auto nLevel = nPrefix < Prefix::kMaxPrefixes ? m_pPrefixLevels[nPrefix].load(std::memory_order_relaxed) : 0;
+                    return nLevel != 0 ? static_cast<int>(level) >= nLevel-1 : level >= m_level;
+                }
+
+                /** @brief Gets the level set for the prefix with the given id
+                *   @return <i>int</i> the level + 1 or 0 if no level has been set for the prefix
+                **/
+                int GetPrefixLevel(uint16_t nPrefix) const { return m_pPrefixLevels[nPrefix].load(std::memory_order_relaxed); }
                 
                 /**
                  * @brief Called by the LogManager when all messages have been processed
-                 * 
+                 * @return <i>bool</i> false if Commit was called and failed
                  */
-                void MessagesDone(){Flush(); }
+                bool MessagesDone()
+                {
+                    Flush();
+                    if(m_batchDurability == Durability::kNone)
+                    {
+                        return true;
+                    }
+                    auto durability = m_batchDurability;
+                    m_batchDurability = Durability::kNone;
+                    return Commit(durability);
+                }
+
+                /** @brief Gets the diagnostic context of the message being output. Only valid during DoOutputMessage
+                *   @return <i>const Context*</i> the context or nullptr if the thread that logged the message had none
+                **/
+                const Context* GetContext() const { return m_pContext; }
+
+                /** @brief Writes the diagnostic context of the message being output as {key=value ...} followed by a tab, or nothing if it has none
+                **/
+                void WriteContext(std::ostream& os) const;
+                void WriteContext(std::string& sLine) const;
+
+                /** @brief Gets the message as a complete line: the timestamp in this output's format, the level, [prefix], the context and the message.
+                *   The Manager renders the line at most once per message for each distinct timestamp format, so outputs with the same format share it. Only valid during DoOutputMessage
+                *   @return <i>const std::string&</i> the line
+                **/
+                const std::string& GetLine() const;
+
+                /** @brief Gets the time the message being output was flushed by the thread that logged it.
+                *   Every output is given the same time for a message. Only valid during DoOutputMessage
+                *   @return <i>std::chrono::system_clock::time_point</i> the time
+                **/
+                std::chrono::system_clock::time_point GetTime() const;
 
                 std::stringstream Timestamp();
-                Level m_level;
+                std::atomic<Level> m_level;     ///< atomic as the level can be changed from any thread while the Manager thread is outputting
                 int m_nTimestamp;
                 TS m_resolution;
+
+            private:
+                std::unique_ptr<std::atomic<int8_t>[]> m_pPrefixLevels;     ///< level+1 for each prefix id, 0 means use m_level
+                std::array<std::atomic<Durability>, 6> m_aDurability{};    ///< for each level
+                Durability m_batchDurability = Durability::kNone;           ///< the highest durability of the messages output in the current batch
+                const Context* m_pContext = nullptr;
+                detail::Renderer* m_pRenderer = nullptr;
         };
 
 
+        /** @brief How the Manager thread waits for messages to arrive
+        **/
+        enum class ConsumerMode
+        {
+            kBlocking,      ///< sleeps until a message arrives
+            kBusyPoll       ///< polls with a pause instruction, then yields, and only sleeps once no message has arrived for Config::busyPollIdle. Keeps a CPU busy while messages are arriving
+        };
+
+        /** @brief Everything the library needs before the first message is logged. Passed to Init
+        **/
+        struct Config
+        {
+            size_t nQueueCapacity = 0;                      ///< the number of messages each queue allocates space for up front, so a burst at start up does not allocate. 0 for the queue's default
+            size_t nShards = 1;                             ///< the number of queues. Threads are given a queue in turn so many threads logging heavily do not all contend for one.
+                                                            ///< Each thread's messages stay in order and each batch the Manager thread takes from the shards is output in time order, but a message in
+                                                            ///< a later batch may be older than one already output from another shard. 0 for one per CPU
+            ConsumerMode consumer = ConsumerMode::kBlocking;
+            std::chrono::microseconds busyPollIdle{1000};  ///< with ConsumerMode::kBusyPoll how long the Manager thread keeps polling after the last message before it sleeps
+            uint32_t nPoolSlots = 0;                        ///< if not 0 the messages are held in a record pool with this many slots. See Stream::UseRecordPool
+            size_t nPoolCapacity = 256;                     ///< the maximum length of a message held in the record pool
+            std::optional<ThreadConfig> thread;             ///< the settings for the Manager thread and any thread the library creates
+            std::vector<std::unique_ptr<Output>> vOutputs;  ///< added together so that the first message is seen by all of them. They are given the indexes 1, 2, 3... in order
+        };
+
+        /** @brief Sets up the library. Must be called before anything else in the library is used and in particular before any Stream is created.
+        *   Without it the library sets itself up with the defaults the first time it is used. Either way the Manager thread is only started once an output has been added
+        *   @param config the settings and the outputs
+        *   @return <i>bool</i> false if the library had already been set up, in which case an error is printed and nothing in the config is applied
+        **/
+        LOG_EXPORT bool Init(Config config);
+
         /** @brief the main logging class
         **/
         class LOG_EXPORT Stream
@@ -159,11 +386,29 @@ namespace pml
             **/
            Stream(Level level = Level::kInfo, const std::string& sPrefix="");
 
-            ///< @brief Copy Constructor
-            Stream(const Stream& lg);
+            /** @brief Constructor
+            *   @param level the level of the current message
+            *   @param prefix the interned prefix of the current message
+            **/
+           Stream(Level level, const Prefix& prefix);
 
-            ///< @brief Assignment operator
-            Stream& operator=(const Stream& lg);
+            /** @brief Constructor
+            *   @param level the level of the current message
+            *   @param logger the logger the message belongs to. The message is only sent to the outputs the logger routes to and has the logger's name as its prefix
+            **/
+           Stream(Level level, const Logger& logger);
+
+            Stream(const Stream&) = delete;
+            Stream& operator=(const Stream&) = delete;
+
+            /** @brief Move constructor. Takes over the message being built without copying it (unless it is short enough to be stored inline).
+            *   The moved-from Stream is left inert: it does not log anything when it is destroyed
+            **/
+            Stream(Stream&& other) noexcept;
+
+            /** @brief Move assignment. Any message this Stream was building is logged first
+            **/
+            Stream& operator=(Stream&& other) noexcept;
 
             ~Stream();
 
@@ -192,6 +437,13 @@ namespace pml
             **/
             static void SetOutputLevel(size_t nIndex, Level level);
 
+            /** @brief Sets the durability of messages of the given level for the Output with the given index
+            *   @param nIndex the index of the Output
+            *   @param level the level
+            *   @param durability the durability
+            **/
+            static void SetDurability(size_t nIndex, Level level, Durability durability);
+
             /** @brief Sets the level a message must meet in order to be output by all the LogOutputs
             *   @param eLevel the level
             *   @deprecated
@@ -203,6 +455,19 @@ namespace pml
             **/
             static void SetOutputLevel(Level level);
 
+            /** @brief Sets the level a message with the given prefix must meet in order to be output by the Output with the given index
+            *   @param nIndex the index of the Output
+            *   @param prefix the prefix
+            *   @param level the level
+            **/
+            static void SetOutputLevel(size_t nIndex, const Prefix& prefix, Level level);
+
+            /** @brief Sets the level a message with the given prefix must meet in order to be output by all the LogOutputs
+            *   @param prefix the prefix
+            *   @param level the level
+            **/
+            static void SetOutputLevel(const Prefix& prefix, Level level);
+
             /** @brief Removes the LogOutput with the given index
             *   @param nIndex the index of the LogOutput
             **/
@@ -212,6 +477,25 @@ namespace pml
             **/
             static void Stop();
 
+            /** @brief Blocks until every message flushed before the call has been passed to all the Outputs and their Flush() has returned
+            *   @param timeout the maximum time to wait
+            *   @return <i>bool</i> true if the messages were all output before the timeout expired
+            **/
+            static bool FlushAll(std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+
+            /** @brief Blocks until every message the calling thread has flushed has been output and committed to the durability set on each Output for its level.
+            *   Many threads can wait at once and they share a single sync of each Output
+            *   @param timeout the maximum time to wait
+            *   @return <i>bool</i> true if the messages were all committed before the timeout expired, false if not, if the last message was dropped or if an Output could not commit the batch it was in
+            **/
+            static bool WaitUntilDurable(std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+
+            /** @brief Sets the CPU affinity, scheduling policy, nice value and name of the Manager thread and of any thread the library creates afterwards.
+            *   Best called at start up. If the Manager thread is already running it applies the new settings at the end of its current batch
+            *   @param config the settings
+            **/
+            static void SetThreadConfig(const ThreadConfig& config);
+
 
             /**
              * @brief logging stream operator for ints, doubles, strings etc
@@ -228,6 +512,91 @@ namespace pml
             }
 
             
+            /**
+             * @brief appends a message built from a format string with {} placeholders. Numbers are written with std::to_chars rather than through the locale.
+             * A placeholder can have a spec of [.precision][type] e.g. {:x} {:.3f}. With C++20 a string literal is checked against the arguments at compile time.
+             * With C++17 it is checked when the message is written and if it does not match the message ends with detail::kFormatError
+             * 
+             * @param sFormat the format string
+             * @param args the values for the placeholders
+             * @return Stream& 
+             */
+            template<typename... Args>
+            Stream& format(detail::FormatStringFor<Args...> sFormat, const Args&... args)
+            {
+                detail::Format(m_buffer, m_stream, sFormat.Get(), args...);
+                if(sFormat.IsValid() == false)
+                {
+                    m_buffer.sputn(detail::kFormatError.data(), static_cast<std::streamsize>(detail::kFormatError.size()));
+                }
+                return *this;
+            }
+
+            /**
+             * @brief appends a message built from a format string created with PML_LOG_FMT. The format string is checked against the arguments at compile time
+             * 
+             * @param args the values for the placeholders
+             * @return Stream& 
+             */
+            template<typename F, typename... Args>
+            std::enable_if_t<std::is_base_of_v<detail::CompiledFormat, F>, Stream&> format(F, const Args&... args)
+            {
+                static_assert(detail::Check<Args...>(F::Get()), "format string does not match the arguments");
+                detail::Format(m_buffer, m_stream, F::Get(), args...);
+                return *this;
+            }
+            
+            /**
+             * @brief appends the result of a callable, which is only called if the message will reach at least one Output, e.g. debug("x").lazy([&]{ return Dump(state); });
+             * The callable can either return something that can be streamed or take a std::ostream& and write to it
+             * 
+             * @param func the callable
+             * @return Stream& 
+             */
+            template<typename F>
+            Stream& lazy(F&& func)
+            {
+                if(IsEnabled())
+                {
+                    if constexpr(std::is_invocable_v<F, std::ostream&>)
+                    {
+                        func(m_stream);
+                    }
+                    else
+                    {
+                        m_stream << func();
+                    }
+                }
+                return *this;
+            }
+
+            /** @brief Checks whether the message would currently be accepted by at least one Output given its level and prefix
+            *   @return <i>bool</i> true if the message would be output
+            **/
+            bool IsEnabled() const;
+
+            /** @brief Checks whether a message with the given level and prefix would currently be accepted by at least one Output.
+            *   A level that no Output accepts for any prefix is rejected with a single atomic load
+            *   @param level the level
+            *   @param sPrefix the prefix
+            *   @return <i>bool</i> true if the message would be output
+            **/
+            static bool IsEnabled(Level level, const std::string& sPrefix="");
+
+            /** @brief Checks whether a message with the given level and prefix would currently be accepted by at least one Output
+            *   @param level the level
+            *   @param prefix the interned prefix
+            *   @return <i>bool</i> true if the message would be output
+            **/
+            static bool IsEnabled(Level level, const Prefix& prefix);
+
+            /** @brief Checks whether a message with the given level would currently be accepted by at least one of the outputs the logger routes to
+            *   @param level the level
+            *   @param logger the logger
+            *   @return <i>bool</i> true if the message would be output
+            **/
+            static bool IsEnabled(Level level, const Logger& logger);
+
             Stream& operator<<(ManipFn manip);
 
             Stream& operator<<(FlagsFn manip);
@@ -246,25 +615,158 @@ namespace pml
             **/
             void flush();
 
+            /** @brief Makes every Stream created afterwards write its message straight in to a slot from a pool allocated now, rather than in to memory allocated for each message.
+            *   Slots are returned to the pool once the message has been output. Messages that do not fit in a slot are truncated and messages logged while every slot is in use are dropped, so the memory used is fixed.
+            *   Must be called at start up before anything is logged
+            *   @param nSlots the number of messages that can be waiting to be output
+            *   @param nCapacity the maximum length of a message
+            *   @return <i>bool</i> false if a pool has already been created
+            **/
+            static bool UseRecordPool(uint32_t nSlots, size_t nCapacity);
+
         protected:
-            const std::stringstream& GetStream() const
+            const std::ostream& GetStream() const
             {
                 return m_stream;
             }
+            std::string_view GetMessage() const
+            {
+                return m_buffer.View();
+            }
             Level GetLevel() const
             {
                 return m_level;
             }
-            const std::string& GetPrefix() const { return m_sPrefix; }
+            const std::string& GetPrefix() const;
 
         private:
 
 
-            std::stringstream m_stream;
+            detail::MessageBuffer m_buffer;
+            std::ostream m_stream;
             Level m_level;
-            std::string m_sPrefix;
+            uint16_t m_nPrefix;
+            uint16_t m_nLogger = 0;
+            std::string m_sPrefix;  ///< only set if the prefix could not be registered
+            bool m_bActive = true;  ///< false once the Stream has been moved from
+
+        };
+
+        /** @brief A named handle that routes its messages to a chosen set of outputs rather than to all of them, e.g. to send a noisy subsystem to its own File.
+        *   Loggers with the same name share their settings. Messages carry the logger's id and the Manager thread uses a mask worked out whenever the outputs or routes change,
+        *   so outputs the logger does not route to never see its messages. Like changes to the outputs, route changes apply from the Manager thread's next batch.
+        *   Create them once and keep them e.g. <i>static pml::log::Logger kNet("net");</i>
+        **/
+        class LOG_EXPORT Logger
+        {
+            public:
+                static constexpr uint16_t kMaxLoggers = 256;    ///< the maximum number of loggers. Once reached new names are not registered, see IsRegistered
+
+                /** @brief Constructor - registers the name if it has not already been registered. A logger starts at Level::kTrace and routes to every output
+                *   @param sName the name of the logger, which is also the prefix of its messages. An empty name gives the default logger used by messages that are not logged through a Logger
+                **/
+                explicit Logger(const std::string& sName);
+
+                /** @brief Gets the id of the logger
+                *   @return <i>uint16_t</i> the id. 0 is the default logger
+                **/
+                uint16_t GetId() const { return m_nId; }
+
+                /** @brief Checks whether the name was registered. If kMaxLoggers loggers are already registered it is not: its messages go through the default logger and setting its level or routes does nothing
+                *   @return <i>bool</i> true if the logger was registered
+                **/
+                bool IsRegistered() const { return m_bRegistered; }
+
+                /** @brief Gets the name of the logger
+                *   @return <i>std::string</i> the name
+                **/
+                const std::string& GetName() const { return m_prefix.GetName(); }
+
+                /** @brief Sets the level a message must meet before it is passed to any of the logger's outputs, which then also apply their own levels
+                *   @param level the level
+                **/
+                void SetLevel(Level level);
+
+                /** @brief Routes the logger's messages to only the given outputs
+                *   @param vOutputs the indexes returned by Stream::AddOutput
+                **/
+                void RouteTo(const std::vector<size_t>& vOutputs);
+
+                /** @brief Adds an output to the ones the logger's messages are routed to
+                *   @param nOutput the index returned by Stream::AddOutput
+                **/
+                void AddRoute(size_t nOutput);
 
+                /** @brief Stops routing the logger's messages to the given output
+                *   @param nOutput the index returned by Stream::AddOutput
+                **/
+                void RemoveRoute(size_t nOutput);
+
+                /** @brief Routes the logger's messages to every output, including ones added later
+                **/
+                void RouteToAll();
+
+                Stream log(Level level = Level::kInfo) const { return Stream(level, *this); }
+                Stream trace() const { return Stream(Level::kTrace, *this); }
+                Stream debug() const { return Stream(Level::kDebug, *this); }
+                Stream info() const { return Stream(Level::kInfo, *this); }
+                Stream warning() const { return Stream(Level::kWarning, *this); }
+                Stream error() const { return Stream(Level::kError, *this); }
+                Stream critical() const { return Stream(Level::kCritical, *this); }
+
+            private:
+                friend class Stream;
+                uint16_t m_nId;
+                bool m_bRegistered;
+                Prefix m_prefix;
         };
+
+        /** @brief wraps a format string that is only known at run time so that it can be passed to format. It is checked when the message is written
+        *   @param sFormat the format string, which must outlive the call to format
+        **/
+        inline detail::RuntimeFormatString RuntimeFormat(std::string_view sFormat) { return detail::RuntimeFormatString{sFormat}; }
+
+        /** @brief logs a message built from a format string, e.g. pml::log::format(pml::log::Level::kInfo, "svc", "took {} us for {}", t, name);
+        *   The format string is checked as it is by Stream::format
+        *   @param level the message level
+        *   @param sPrefix the prefix
+        *   @param sFormat the format string
+        *   @param args the values for the placeholders
+        *   @return <i>Stream</i> the stream, which more can be appended to
+        **/
+        template<typename... Args>
+        Stream format(Level level, const std::string& sPrefix, detail::FormatStringFor<Args...> sFormat, const Args&... args)
+        {
+            Stream stream(level, sPrefix);
+            stream.format(sFormat, args...);
+            return stream;
+        }
+
+        template<typename... Args>
+        Stream format(Level level, const Prefix& prefix, detail::FormatStringFor<Args...> sFormat, const Args&... args)
+        {
+            Stream stream(level, prefix);
+            stream.format(sFormat, args...);
+            return stream;
+        }
+
+        /** @brief logs a message built from a format string created with PML_LOG_FMT, which is checked against the arguments at compile time
+        **/
+        template<typename F, typename... Args>
+        std::enable_if_t<std::is_base_of_v<detail::CompiledFormat, F>, Stream> format(Level level, const std::string& sPrefix, F sFormat, const Args&... args)
+        {
+            Stream stream(level, sPrefix);
+            stream.format(sFormat, args...);
+            return stream;
+        }
+
+        template<typename F, typename... Args>
+        std::enable_if_t<std::is_base_of_v<detail::CompiledFormat, F>, Stream> format(Level level, const Prefix& prefix, F sFormat, const Args&... args)
+        {
+            Stream stream(level, prefix);
+            stream.format(sFormat, args...);
+            return stream;
+        }
     }
 
   
@@ -277,5 +779,13 @@ namespace pml
 **/
 LOG_EXPORT pml::log::Stream pmlLog(pml::enumLevel elevel = pml::LOG_INFO, const std::string& sPrefix="");
 
+/** @brief logs a message only if at least one Output would accept it. Otherwise nothing to the right of the macro is evaluated.
+*   A level that no Output accepts for any prefix is rejected inline, before the prefix is even turned into a string.
+*   Usage is PML_LOG_IF(pml::log::Level::kDebug, "prefix") << Dump(state);
+**/
+#define PML_LOG_IF(level, prefix) if(pml::log::detail::IsAboveFloor(level) == false || pml::log::Stream::IsEnabled(level, prefix) == false){} else pml::log::Stream(level, prefix)
+#define PML_LOG_TRACE_IF(prefix) PML_LOG_IF(pml::log::Level::kTrace, prefix)
+#define PML_LOG_DEBUG_IF(prefix) PML_LOG_IF(pml::log::Level::kDebug, prefix)
+
 
 #endif
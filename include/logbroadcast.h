@@ -0,0 +1,89 @@
+#ifndef PML_LOG_BROADCAST_H
+#define PML_LOG_BROADCAST_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "dlllog.h"
+#include "log.h"
+
+namespace pml::log
+{
+    namespace detail
+    {
+        class BroadcastRing;
+    }
+
+    /** @brief Output class that publishes each message once in to a fixed size ring that any number of in-process Subscribers can read, e.g. to show a live log in an admin UI.
+    *   The Manager thread never waits for the subscribers and they never take a lock: a subscriber that falls more than a ring's worth of messages behind
+    *   skips to the oldest message that is still in the ring and the number of messages it missed is added to its overrun count
+    **/
+    class LOG_EXPORT Broadcast : public Output
+    {
+        public:
+            /** @brief a message read by a Subscriber
+            **/
+            struct Record
+            {
+                std::chrono::system_clock::time_point tp;
+                Level level = Level::kInfo;
+                std::string sPrefix;
+                std::string sContext;       ///< the diagnostic context as key=value pairs separated by spaces. Empty if the thread had none
+                std::string sMessage;       ///< without the trailing new line. Cut short if it does not fit in a slot
+                bool bTruncated = false;
+            };
+
+            /** @brief reads the messages published by a Broadcast. Each subscriber has its own position in the ring. A copy of a subscriber starts at the same position as the
+            *   original and then moves on independently, so one subscriber can be kept to create more. A single Subscriber must only be used by one thread at a time
+            **/
+            class LOG_EXPORT Subscriber
+            {
+                public:
+                    /** @brief Gets the next message
+                    *   @param rec the record to fill in. Its strings are reused so reading in to the same record does not allocate once they have grown
+                    *   @return <i>bool</i> true if there was a message, false if the subscriber has caught up
+                    **/
+                    bool Next(Record& rec);
+
+                    /** @brief Moves the subscriber so that the next message read is the next one published
+                    **/
+                    void SkipToLatest();
+
+                    /** @brief Moves the subscriber back to the oldest message still in the ring, e.g. to show some history before the live messages
+                    **/
+                    void SkipToOldest();
+
+                    /** @brief Gets the number of messages this subscriber has missed because the ring was overwritten before it read them
+                    *   @return <i>uint64_t</i> the number of missed messages
+                    **/
+                    uint64_t GetOverrun() const { return m_nOverrun; }
+
+                private:
+                    friend class Broadcast;
+                    explicit Subscriber(std::shared_ptr<detail::BroadcastRing> pRing);
+
+                    std::shared_ptr<detail::BroadcastRing> m_pRing;
+                    uint64_t m_nCursor = 0;
+                    uint64_t m_nOverrun = 0;
+            };
+
+            /** @brief Constructor
+            *   @param nSlots the number of messages the ring holds. Rounded up to a power of 2
+            **/
+            explicit Broadcast(size_t nSlots=4096);
+
+            /** @brief Creates a subscriber that starts at the next message published. The subscriber keeps the ring alive so it can still be used once the Broadcast has been removed
+            *   @return <i>Subscriber</i> the subscriber
+            **/
+            Subscriber Subscribe() const;
+
+        private:
+            void DoOutputMessage(Level level, const std::string&  sLog, const std::string& sPrefix) override;
+
+            std::shared_ptr<detail::BroadcastRing> m_pRing;
+    };
+}
+
+#endif
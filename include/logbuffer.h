@@ -0,0 +1,133 @@
+#ifndef PML_LOG_BUFFER_H
+#define PML_LOG_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+#include "dlllog.h"
+
+namespace pml::log::detail
+{
+    /** @brief A fixed number of fixed size message slots allocated up front. Slots are claimed by the thread writing a message and released by the Manager once the message has been output.
+    *   The free slots are kept in a lock-free stack so neither claiming nor releasing takes a lock or allocates
+    **/
+    class LOG_EXPORT RecordPool
+    {
+        public:
+            static constexpr uint32_t kNoSlot = 0xFFFFFFFF;
+
+            RecordPool(uint32_t nSlots, size_t nCapacity);
+
+            /** @brief Claims a free slot
+            *   @return <i>uint32_t</i> the slot or kNoSlot if all the slots are in use
+            **/
+            uint32_t Claim();
+
+            /** @brief Returns a slot to the pool
+            **/
+            void Release(uint32_t nSlot);
+
+            char* GetData(uint32_t nSlot) { return m_pData.get()+static_cast<size_t>(nSlot)*m_nCapacity; }
+            size_t GetCapacity() const { return m_nCapacity; }
+            uint32_t GetSlots() const { return m_nSlots; }
+
+            /** @brief Gets the number of messages that were dropped because there were no free slots
+            **/
+            size_t GetExhausted() const { return m_nExhausted; }
+
+            /** @brief Gets the number of messages that were cut short because they did not fit in a slot
+            **/
+            size_t GetTruncated() const { return m_nTruncated; }
+
+        private:
+            friend class MessageBuffer;
+
+            uint32_t m_nSlots;
+            size_t m_nCapacity;
+            std::unique_ptr<char[]> m_pData;
+            std::unique_ptr<std::atomic<uint32_t>[]> m_pNext;
+            std::atomic<uint64_t> m_nHead;      ///< ABA tag in the top 32 bits, first free slot in the bottom 32 bits
+
+            std::atomic<size_t> m_nExhausted{0};
+            std::atomic<size_t> m_nTruncated{0};
+    };
+
+    /** @brief The stream buffer a Stream writes its message in to. Without a RecordPool short messages are kept in a small inline buffer and longer ones in a heap buffer that grows as needed and is handed to the Manager without being copied.
+    *   With a RecordPool the message is written straight in to a pool slot and anything that does not fit is dropped
+    **/
+    class LOG_EXPORT MessageBuffer : public std::streambuf
+    {
+        public:
+            static constexpr size_t kInlineCapacity = 208;  ///< matches the inline storage of a queued record, which is what is left of its 256 bytes after the other fields
+
+            explicit MessageBuffer(RecordPool* pPool);
+            ~MessageBuffer();
+
+            MessageBuffer(const MessageBuffer&) = delete;
+            MessageBuffer& operator=(const MessageBuffer&) = delete;
+
+            /** @brief Takes over the other buffer's message, heap buffer or pool slot. Only an inline message is copied. The other buffer is left empty
+            **/
+            MessageBuffer(MessageBuffer&& other) noexcept;
+            MessageBuffer& operator=(MessageBuffer&& other) noexcept;
+
+            std::string_view View() const { return std::string_view(pbase(), GetLength()); }
+            size_t GetLength() const { return static_cast<size_t>(pptr()-pbase()); }
+            RecordPool* GetPool() const { return m_pPool; }
+
+            /** @brief true if the pool had no free slots when the message was started
+            **/
+            bool IsDropped() const { return m_bDropped; }
+
+            /** @brief Empties the buffer, keeping any memory or slot for the next message
+            **/
+            void Clear();
+
+            /** @brief true if the message is in the inline buffer rather than the heap or a pool slot
+            **/
+            bool IsInline() const { return pbase() == m_aInline; }
+
+            /** @brief Takes the heap buffer holding the message out of the buffer without copying it. The buffer is left empty, writing to its inline buffer
+            **/
+            std::unique_ptr<char[]> TakeHeap();
+
+            /** @brief Takes the slot holding the message out of the buffer. The buffer is left empty. A truncated message has its last character replaced with a new line
+            *   @return <i>uint32_t</i> the slot or RecordPool::kNoSlot if nothing was written
+            **/
+            uint32_t TakeSlot();
+
+            /** @brief Makes room to write nLength characters in place
+            *   @return <i>char*</i> where to write them or nullptr if a pool slot does not have room, in which case they should be written with sputn so that they are cut short
+            **/
+            char* Reserve(size_t nLength);
+
+            /** @brief Adds the characters written in place after a call to Reserve
+            *   @param pEnd the end of the characters written
+            **/
+            void Commit(char* pEnd) { pbump(static_cast<int>(pEnd-pptr())); }
+
+        protected:
+            int_type overflow(int_type c) override;
+            std::streamsize xsputn(const char* pData, std::streamsize nLength) override;
+
+        private:
+            bool Grow(size_t nNeeded);
+
+            void UseInline();
+            void TakeFrom(MessageBuffer& other);
+
+            RecordPool* m_pPool;
+            char m_aInline[kInlineCapacity];
+            std::unique_ptr<char[]> m_pHeap;
+            size_t m_nHeapCapacity = 0;
+            uint32_t m_nSlot = RecordPool::kNoSlot;
+            bool m_bDropped = false;
+            bool m_bTruncated = false;
+    };
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef PML_LOG_COLLECTOR_H
+#define PML_LOG_COLLECTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dlllog.h"
+#include "log.h"
+
+#ifdef __linux__
+namespace pml::log
+{
+    namespace detail
+    {
+        class ShmReader;
+        class Renderer;
+    }
+
+    /** @brief Reads the shared memory rings written by the SharedMemory outputs of every process on the host that uses the same channel and passes the messages on to its own outputs,
+    *   so that many processes can share one set of log files. Messages from different processes are merged in time order: a message is passed on once every live process has a
+    *   later message waiting and it is older than half the merge window, or once it is older than the merge window. Processes are found within half a window of starting and their rings are removed once they have exited and been read.
+    *   The position in each ring is kept in the ring, so a collector that is restarted carries on from where the last one stopped.
+    *   A Collector is not thread safe: Poll or Run must only be called from one thread
+    **/
+    class LOG_EXPORT Collector
+    {
+        public:
+            /** @brief Constructor
+            *   @param sChannel the channel the SharedMemory outputs were created with
+            *   @param window how long to wait for a slower process before passing on a message out of time order
+            **/
+            explicit Collector(const std::string& sChannel, std::chrono::milliseconds window=std::chrono::milliseconds(100));
+            ~Collector();
+
+            /** @brief Adds an output that the merged messages are passed to. The output's levels and prefix levels filter the messages as they would in the Manager
+            *   @param pOutput the output
+            **/
+            void AddOutput(std::unique_ptr<Output> pOutput);
+
+            /** @brief Finds new processes if it is time to, and passes on every message that is ready
+            *   @return <i>size_t</i> the number of messages passed on
+            **/
+            size_t Poll();
+
+            /** @brief Calls Poll until bRun is false, sleeping for a short while whenever there is nothing to do
+            *   @param bRun set to false from another thread or a signal handler to stop
+            **/
+            void Run(const std::atomic_bool& bRun);
+
+            /** @brief Gets the number of processes whose rings are being read
+            **/
+            size_t GetProducerCount() const { return m_vReaders.size(); }
+
+            /** @brief Gets the number of messages the processes currently being read have dropped because their ring was full
+            **/
+            uint64_t GetDropped() const;
+
+        private:
+            void Discover();
+            void Pass(detail::ShmReader& reader);
+            void Commit();
+
+            std::string m_sPrefix;      ///< the start of the name of every segment for the channel
+            std::chrono::milliseconds m_window;
+            std::chrono::milliseconds m_discover;   ///< how often to look for new processes
+            std::vector<std::unique_ptr<detail::ShmReader>> m_vReaders;
+            std::vector<std::unique_ptr<Output>> m_vOutputs;
+            std::unique_ptr<detail::Renderer> m_pRenderer;
+            std::chrono::steady_clock::time_point m_tpDiscover;
+    };
+}
+#endif
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef PML_LOG_CONTEXT_H
+#define PML_LOG_CONTEXT_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "dlllog.h"
+
+namespace pml::log
+{
+    /** @brief An immutable snapshot of the key/value pairs of a thread's diagnostic context. A new snapshot is made each time a ScopedContext is created, holding
+    *   all the pairs of the scopes that enclose it, and each message flushed by the thread refers to the snapshot that was current rather than copying the pairs.
+    *   Every snapshot has a unique version so Outputs can cache anything they render from it
+    **/
+    class LOG_EXPORT Context
+    {
+        public:
+            using Entry = std::pair<std::string, std::string>;
+
+            /** @brief Gets the key/value pairs, outermost scope first
+            **/
+            const std::vector<Entry>& GetEntries() const { return m_vEntries; }
+
+            /** @brief Gets the pairs rendered as key=value separated by spaces, made once when the snapshot was created
+            **/
+            const std::string& GetText() const { return m_sText; }
+
+            /** @brief Gets the version of the snapshot. No two snapshots have the same version
+            **/
+            uint64_t GetVersion() const { return m_nVersion; }
+
+            /** @brief Gets the snapshot that is current for the calling thread
+            *   @return <i>const Context*</i> the snapshot or nullptr if the thread has no context
+            **/
+            static const Context* Current();
+
+            void AddRef() const { m_nRefs.fetch_add(1, std::memory_order_relaxed); }
+            void Release() const;
+
+        private:
+            friend class ScopedContext;
+            friend class Collector;
+            Context(const Context* pParent, std::string sKey, std::string sValue);
+            explicit Context(std::vector<Entry> vEntries);
+
+            std::vector<Entry> m_vEntries;
+            std::string m_sText;
+            uint64_t m_nVersion;
+            mutable std::atomic<uint32_t> m_nRefs{1};
+    };
+
+    /** @brief Adds a key/value pair to the calling thread's diagnostic context for as long as it is in scope. Usage is pml::log::ScopedContext ctx{"req", nRequestId};
+    *   Scopes must be destroyed in the reverse order to which they were created, which happens naturally when they are local variables
+    **/
+    class LOG_EXPORT ScopedContext
+    {
+        public:
+            ScopedContext(std::string sKey, std::string sValue);
+
+            /** @brief A null value is shown as (null), as printf would
+            **/
+            ScopedContext(std::string sKey, const char* pValue) : ScopedContext(std::move(sKey), std::string(pValue ? pValue : "(null)")){}
+
+            template<typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+            ScopedContext(std::string sKey, T value) : ScopedContext(std::move(sKey), std::to_string(value)){}
+
+            ~ScopedContext();
+
+            ScopedContext(const ScopedContext&) = delete;
+            ScopedContext& operator=(const ScopedContext&) = delete;
+
+        private:
+            const Context* m_pContext;
+            const Context* m_pPrevious;
+    };
+
+    namespace detail
+    {
+        /** @brief holds a reference to a Context snapshot. The size of a pointer so that it fits in a queued record
+        **/
+        class ContextPtr
+        {
+            public:
+                ContextPtr() = default;
+                explicit ContextPtr(const Context* pContext) : m_pContext(pContext)
+                {
+                    if(m_pContext)
+                    {
+                        m_pContext->AddRef();
+                    }
+                }
+                ~ContextPtr() { reset(); }
+
+                ContextPtr(ContextPtr&& other) noexcept : m_pContext(other.m_pContext) { other.m_pContext = nullptr; }
+                ContextPtr& operator=(ContextPtr&& other) noexcept
+                {
+                    if(&other != this)
+                    {
+                        reset();
+                        m_pContext = other.m_pContext;
+                        other.m_pContext = nullptr;
+                    }
+                    return *this;
+                }
+
+                ContextPtr(const ContextPtr&) = delete;
+                ContextPtr& operator=(const ContextPtr&) = delete;
+
+                const Context* get() const { return m_pContext; }
+
+                void reset()
+                {
+                    if(m_pContext)
+                    {
+                        m_pContext->Release();
+                        m_pContext = nullptr;
+                    }
+                }
+
+            private:
+                const Context* m_pContext = nullptr;
+        };
+    }
+}
+
+#endif
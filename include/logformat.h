@@ -0,0 +1,385 @@
+#ifndef PML_LOG_FORMAT_H
+#define PML_LOG_FORMAT_H
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "logbuffer.h"
+
+/** @brief creates a format string that is checked against the arguments at compile time. Usage is pml::log::info().format(PML_LOG_FMT("took {} us for {}"), t, name);
+**/
+#define PML_LOG_FMT(s) [] { struct Fmt : pml::log::detail::CompiledFormat { static constexpr std::string_view Get() { return s; } }; return Fmt{}; }()
+
+namespace pml::log::detail
+{
+    /** @brief base of the types created by PML_LOG_FMT
+    **/
+    struct CompiledFormat{};
+
+    /** @brief how an argument gets written
+    **/
+    enum class ArgKind { kInteger, kFloating, kString, kChar, kBool, kPointer, kOther };
+
+    template<typename T> constexpr ArgKind KindOf()
+    {
+        using U = std::decay_t<T>;
+        if constexpr(std::is_same_v<U, bool>)                   return ArgKind::kBool;
+        else if constexpr(std::is_same_v<U, char>)              return ArgKind::kChar;
+        else if constexpr(std::is_integral_v<U>)                return ArgKind::kInteger;
+        else if constexpr(std::is_floating_point_v<U>)          return ArgKind::kFloating;
+        else if constexpr(std::is_same_v<U, const char*> || std::is_same_v<U, char*> ||
+                          std::is_same_v<U, std::string> || std::is_same_v<U, std::string_view>)   return ArgKind::kString;
+        else if constexpr(std::is_pointer_v<U>)                 return ArgKind::kPointer;
+        else                                                    return ArgKind::kOther;
+    }
+
+    /** @brief a single {} or {:spec} in a format string. The spec is [.precision][type]
+    **/
+    struct Placeholder
+    {
+        bool bValid = false;
+        size_t nEnd = 0;        ///< the position after the closing brace
+        char cType = 0;
+        int nPrecision = -1;
+    };
+
+    constexpr Placeholder ParsePlaceholder(std::string_view sFormat, size_t nPos)
+    {
+        Placeholder ph;
+        auto i = nPos+1;
+        if(i < sFormat.size() && sFormat[i] == ':')
+        {
+            ++i;
+            if(i < sFormat.size() && sFormat[i] == '.')
+            {
+                ++i;
+                if(i >= sFormat.size() || sFormat[i] < '0' || sFormat[i] > '9')
+                {
+                    return ph;
+                }
+                ph.nPrecision = 0;
+                for(; i < sFormat.size() && sFormat[i] >= '0' && sFormat[i] <= '9'; ++i)
+                {
+                    ph.nPrecision = ph.nPrecision*10 + (sFormat[i]-'0');
+                    if(ph.nPrecision > 99)
+                    {
+                        return ph;
+                    }
+                }
+            }
+            if(i < sFormat.size() && sFormat[i] != '}')
+            {
+                ph.cType = sFormat[i];
+                ++i;
+            }
+        }
+        if(i < sFormat.size() && sFormat[i] == '}')
+        {
+            ph.bValid = true;
+            ph.nEnd = i+1;
+        }
+        return ph;
+    }
+
+    constexpr bool SpecAllowed(ArgKind kind, char cType, int nPrecision)
+    {
+        if(nPrecision >= 0 && kind != ArgKind::kFloating)
+        {
+            return false;
+        }
+        switch(kind)
+        {
+            case ArgKind::kInteger:
+                return cType == 0 || cType == 'd' || cType == 'x' || cType == 'X' || cType == 'o' || cType == 'b';
+            case ArgKind::kFloating:
+                return cType == 0 || cType == 'f' || cType == 'e' || cType == 'g';
+            case ArgKind::kString:
+            case ArgKind::kBool:
+                return cType == 0 || cType == 's';
+            case ArgKind::kChar:
+                return cType == 0 || cType == 'c';
+            case ArgKind::kPointer:
+                return cType == 0 || cType == 'p';
+            default:
+                return cType == 0;
+        }
+    }
+
+    /** @brief a format string that is only known at run time. See pml::log::RuntimeFormat
+    **/
+    struct RuntimeFormatString
+    {
+        std::string_view sFormat;
+    };
+
+    /** @brief checks that every placeholder in the format string is well formed, matches the type of its argument and that there is one argument per placeholder
+    **/
+    template<typename... Args>
+    constexpr bool Check(std::string_view sFormat)
+    {
+        constexpr ArgKind aKinds[] = {KindOf<Args>()..., ArgKind::kOther};
+        size_t nArg = 0;
+        for(size_t i = 0; i < sFormat.size();)
+        {
+            if(sFormat[i] == '{')
+            {
+                if(i+1 < sFormat.size() && sFormat[i+1] == '{')
+                {
+                    i += 2;
+                    continue;
+                }
+                auto ph = ParsePlaceholder(sFormat, i);
+                if(ph.bValid == false || nArg >= sizeof...(Args) || SpecAllowed(aKinds[nArg], ph.cType, ph.nPrecision) == false)
+                {
+                    return false;
+                }
+                ++nArg;
+                i = ph.nEnd;
+            }
+            else if(sFormat[i] == '}')
+            {
+                if(i+1 < sFormat.size() && sFormat[i+1] == '}')
+                {
+                    i += 2;
+                    continue;
+                }
+                return false;
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        return nArg == sizeof...(Args);
+    }
+
+    /** @brief called by FormatString when a format string does not match its arguments. It is never defined: calling it at compile time is what reports the error
+    **/
+    void FormatStringDoesNotMatchTheArguments();
+
+    /** @brief added to a message whose format string was only checked when it was written and did not match the arguments
+    **/
+    inline constexpr std::string_view kFormatError = " [format string does not match the arguments]";
+
+    /** @brief a format string given as a plain string. With C++20 a string literal is checked against the arguments at compile time, as with PML_LOG_FMT.
+    *   C++17 cannot do that, so the format string is checked when the message is written instead
+    **/
+    template<typename... Args>
+    class FormatString
+    {
+        public:
+#ifdef __cpp_consteval
+            template<typename S, typename = std::enable_if_t<std::is_convertible_v<const S&, std::string_view>>>
+            consteval FormatString(const S& sFormat) : m_sFormat(sFormat)
+            {
+                if(Check<Args...>(m_sFormat) == false)
+                {
+                    FormatStringDoesNotMatchTheArguments();
+                }
+            }
+#else
+            template<typename S, typename = std::enable_if_t<std::is_convertible_v<const S&, std::string_view>>>
+            FormatString(const S& sFormat) : m_sFormat(sFormat), m_bValid(Check<Args...>(m_sFormat)){}
+#endif
+            /** @brief a format string that is only known at run time, made with pml::log::RuntimeFormat. It is checked when the message is written
+            **/
+            FormatString(RuntimeFormatString sFormat) : m_sFormat(sFormat.sFormat), m_bValid(Check<Args...>(m_sFormat)){}
+
+            std::string_view Get() const { return m_sFormat; }
+            bool IsValid() const { return m_bValid; }
+
+        private:
+            std::string_view m_sFormat;
+            bool m_bValid = true;
+    };
+
+    template<typename T> struct TypeIdentity { using type = T; };
+
+    /** @brief stops the format string from taking part in deducing Args so that they come from the arguments alone
+    **/
+    template<typename... Args> using FormatStringFor = FormatString<typename TypeIdentity<Args>::type...>;
+
+    /** @brief writes the formatted message straight in to the Stream's MessageBuffer. Types that are written using operator<< go through the stream, which writes to the same buffer
+    **/
+    class FormatBuffer
+    {
+        public:
+            static constexpr size_t kMaxChars = 128;   ///< the most characters a single number can need
+
+            FormatBuffer(MessageBuffer& buffer, std::ostream& os) : m_buffer(buffer), m_os(os){}
+
+            void Append(const char* pData, size_t nLength)
+            {
+                m_buffer.sputn(pData, static_cast<std::streamsize>(nLength));
+            }
+
+            /** @brief calls write(pStart, pEnd) to write at most nMax characters, in place if the buffer has room for them
+            *   @param write returns the end of what it wrote or nullptr if it could not write the value
+            *   @return <i>bool</i> false if write failed
+            **/
+            template<typename F>
+            bool WriteChars(size_t nMax, F&& write)
+            {
+                if(auto pStart = m_buffer.Reserve(nMax))
+                {
+                    auto pEnd = write(pStart, pStart+nMax);
+                    if(pEnd)
+                    {
+                        m_buffer.Commit(pEnd);
+                    }
+                    return pEnd != nullptr;
+                }
+
+                //a pool slot that is nearly full: write to the side and let the buffer cut it short
+                char aChars[kMaxChars];
+                auto pEnd = write(aChars, aChars+std::min(nMax, kMaxChars));
+                if(pEnd)
+                {
+                    Append(aChars, static_cast<size_t>(pEnd-aChars));
+                }
+                return pEnd != nullptr;
+            }
+
+            /** @brief gives direct access to the stream for types that are written using operator<<
+            **/
+            std::ostream& Stream() { return m_os; }
+
+        private:
+            MessageBuffer& m_buffer;
+            std::ostream& m_os;
+    };
+
+    template<typename T>
+    void WriteArg(FormatBuffer& buffer, const T& value, char cType, int nPrecision)
+    {
+        constexpr auto kind = KindOf<T>();
+        if constexpr(kind == ArgKind::kInteger)
+        {
+            auto nBase = cType == 'x' || cType == 'X' ? 16 : cType == 'o' ? 8 : cType == 'b' ? 2 : 10;
+            buffer.WriteChars(sizeof(T)*8+1, [&](char* pStart, char* pEnd)
+            {
+                auto result = std::to_chars(pStart, pEnd, value, nBase);
+                if(cType == 'X')
+                {
+                    for(auto p = pStart; p != result.ptr; ++p)
+                    {
+                        *p = (*p >= 'a' && *p <= 'f') ? static_cast<char>(*p-'a'+'A') : *p;
+                    }
+                }
+                return result.ptr;
+            });
+        }
+        else if constexpr(kind == ArgKind::kFloating)
+        {
+            auto bWritten = buffer.WriteChars(FormatBuffer::kMaxChars, [&](char* pStart, char* pEnd) -> char*
+            {
+                std::to_chars_result result;
+                if(cType == 0 && nPrecision < 0)
+                {
+                    result = std::to_chars(pStart, pEnd, value);
+                }
+                else
+                {
+                    auto format = cType == 'f' || cType == 0 ? std::chars_format::fixed : cType == 'e' ? std::chars_format::scientific : std::chars_format::general;
+                    result = nPrecision < 0 ? std::to_chars(pStart, pEnd, value, format) : std::to_chars(pStart, pEnd, value, format, nPrecision);
+                }
+                return result.ec == std::errc() ? result.ptr : nullptr;
+            });
+            if(bWritten == false)
+            {
+                buffer.Stream() << value;
+            }
+        }
+        else if constexpr(kind == ArgKind::kString)
+        {
+            if constexpr(std::is_pointer_v<std::decay_t<T>>)
+            {
+                const char* pValue = value;
+                if(pValue == nullptr)
+                {
+                    buffer.Append("(null)", 6);
+                    return;
+                }
+            }
+            std::string_view sValue(value);
+            buffer.Append(sValue.data(), sValue.size());
+        }
+        else if constexpr(kind == ArgKind::kChar)
+        {
+            buffer.Append(&value, 1);
+        }
+        else if constexpr(kind == ArgKind::kBool)
+        {
+            value ? buffer.Append("true", 4) : buffer.Append("false", 5);
+        }
+        else if constexpr(kind == ArgKind::kPointer)
+        {
+            buffer.Append("0x", 2);
+            buffer.WriteChars(sizeof(uintptr_t)*2, [&](char* pStart, char* pEnd)
+            {
+                return std::to_chars(pStart, pEnd, reinterpret_cast<uintptr_t>(value), 16).ptr;
+            });
+        }
+        else
+        {
+            buffer.Stream() << value;
+        }
+    }
+
+    template<typename... Args>
+    void WriteNthArg(FormatBuffer& buffer, size_t nArg, const Placeholder& ph, const Args&... args)
+    {
+        if constexpr(sizeof...(Args) != 0)
+        {
+            size_t i = 0;
+            ((i++ == nArg ? WriteArg(buffer, args, ph.cType, ph.nPrecision) : void()), ...);
+        }
+    }
+
+    /** @brief writes the formatted message to the Stream's buffer. The format string must already have been checked: placeholders that are malformed or have no argument are written as they are
+    **/
+    template<typename... Args>
+    void Format(MessageBuffer& messageBuffer, std::ostream& os, std::string_view sFormat, const Args&... args)
+    {
+        FormatBuffer buffer(messageBuffer, os);
+        size_t nArg = 0;
+        size_t nText = 0;
+        for(size_t i = 0; i < sFormat.size();)
+        {
+            if((sFormat[i] == '{' || sFormat[i] == '}') && i+1 < sFormat.size() && sFormat[i+1] == sFormat[i])
+            {
+                buffer.Append(sFormat.data()+nText, i+1-nText);
+                i += 2;
+                nText = i;
+            }
+            else if(sFormat[i] == '{')
+            {
+                auto ph = ParsePlaceholder(sFormat, i);
+                if(ph.bValid && nArg < sizeof...(Args))
+                {
+                    buffer.Append(sFormat.data()+nText, i-nText);
+                    WriteNthArg(buffer, nArg, ph, args...);
+                    ++nArg;
+                    i = ph.nEnd;
+                    nText = i;
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        buffer.Append(sFormat.data()+nText, sFormat.size()-nText);
+    }
+}
+
+#endif
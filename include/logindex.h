@@ -0,0 +1,49 @@
+#ifndef PML_LOG_INDEX_H
+#define PML_LOG_INDEX_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace pml::log
+{
+    /** @brief The layout of the sidecar index that File can write next to each YYYY-MM-DDTHH.log file. The index is named YYYY-MM-DDTHH.idx and is
+    *   an IndexHeader followed by one IndexBlock for each interval that had messages in it. Blocks are appended when they are complete so the end of the
+    *   log file after the last block has not been indexed yet
+    **/
+    struct IndexHeader
+    {
+        static constexpr char kMagic[8] = {'P','M','L','I','D','X','1','\0'};
+
+        char aMagic[8];
+        int64_t nHour;          ///< the start of the hour the log file covers in seconds since the epoch
+
+        bool IsValid() const { return std::memcmp(aMagic, kMagic, sizeof(kMagic)) == 0; }
+    };
+
+    struct IndexBlock
+    {
+        static constexpr int kLevels = 6;
+
+        int64_t nStart;         ///< the start of the interval the block covers in seconds since the epoch
+        int64_t nEnd;           ///< one second after the last message in the block
+        uint64_t nOffset;       ///< the offset of the first message of the block in the log file
+        uint64_t nLength;       ///< the number of bytes of the log file in the block
+        uint32_t aCount[kLevels];   ///< the number of messages of each level in the block
+
+        /** @brief returns the number of messages in the block at or above the given level
+        **/
+        uint64_t CountFrom(int nLevel) const
+        {
+            uint64_t nCount = 0;
+            for(int i = nLevel < 0 ? 0 : nLevel; i < kLevels; i++)
+            {
+                nCount += aCount[i];
+            }
+            return nCount;
+        }
+    };
+
+    static_assert(sizeof(IndexHeader) == 16 && sizeof(IndexBlock) == 56, "index layout must not depend on the compiler");
+}
+
+#endif
@@ -1,87 +1,322 @@
 #ifndef PML_LOG_MANAGER_H
 #define PML_LOG_MANAGER_H
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <ctime>
+#include <deque>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <set>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
-#include "blockingconcurrentqueue.h"
+#include "concurrentqueue.h"
 #include "dlllog.h"
 #include "log.h"
+#include "logcontext.h"
+#include "lightweightsemaphore.h"
 
 namespace pml::log
 {
+    /** @brief Interns prefix names into small integer ids. Ids are never reused so names can be looked up without a lock
+    **/
+    class PrefixRegistry
+    {
+        public:
+            static PrefixRegistry& Get();
+
+            uint16_t Intern(const std::string& sName);
+            const std::string& GetName(uint16_t nId) const { return *m_aNames[nId].load(std::memory_order_acquire); }
+            uint16_t GetCount() const { return m_nCount.load(std::memory_order_acquire); }
+
+        private:
+            PrefixRegistry();
+
+            std::mutex m_mutex;
+            std::unordered_map<std::string, uint16_t> m_mIds;   ///< protected by m_mutex
+            std::deque<std::string> m_dNames;                   ///< owns the names. protected by m_mutex
+            std::array<std::atomic<const std::string*>, Prefix::kMaxPrefixes> m_aNames;
+            std::atomic<uint16_t> m_nCount{0};
+    };
     
+    namespace detail
+    {
+        /** @brief renders the line for the message the Manager thread is outputting, once for each distinct timestamp format that an output asks for.
+        *   The lines keep their capacity from one message to the next and the local time is only worked out once a second
+        **/
+        class Renderer
+        {
+            public:
+                Renderer() { m_vFormats.reserve(4); }
+
+                void Start(std::chrono::system_clock::time_point tp, Level level, const std::string& sPrefix, const std::string& sLog, const Context* pContext);
+                const std::string& GetLine(int nTimestamp, Output::TS resolution);
+                std::chrono::system_clock::time_point GetTime() const { return m_tp; }
+
+            private:
+                struct format
+                {
+                    int nTimestamp;
+                    Output::TS resolution;
+                    uint64_t nMessage = 0;      ///< the message sLine was rendered for
+                    std::string sLine;
+                };
+
+                void Render(format& aFormat);
+
+                std::vector<format> m_vFormats;
+                uint64_t m_nMessage = 0;
+
+                std::chrono::system_clock::time_point m_tp;
+                Level m_level = Level::kInfo;
+                const std::string* m_pPrefix = nullptr;
+                const std::string* m_pLog = nullptr;
+                const Context* m_pContext = nullptr;
+
+                time_t m_nLocalSecond = -1;
+                tm m_tmLocal{};
+        };
+    }
+
     class Manager
     {
         private:
             friend class Stream;
+            friend class Logger;
+            friend bool Init(Config config);
 
             static Manager& Get();
             Manager();
             ~Manager();
 
+            bool Init(Config config);
+            void StartThread();
+
             size_t AddOutput(std::unique_ptr<Output> pLogout);
             void SetOutputLevel(size_t nIndex, Level level);
             void SetOutputLevel(Level level);
+            void SetOutputLevel(size_t nIndex, const Prefix& prefix, Level level);
+            void SetOutputLevel(const Prefix& prefix, Level level);
             void RemoveOutput(size_t nIndex);
+            void SetDurability(size_t nIndex, Level level, Durability durability);
+
+            void Flush(detail::MessageBuffer& buffer, Level level, uint16_t nPrefix, const std::string& sPrefix, uint16_t nLogger);
+
+            bool IsEnabled(Level level, uint16_t nPrefix, uint16_t nLogger=0) const;
+
+            std::optional<uint16_t> RegisterLogger(const std::string& sName);
+            void SetLoggerLevel(uint16_t nLogger, Level level);
+            void SetLoggerRoutes(uint16_t nLogger, std::optional<std::set<size_t>> routes);
+            void AddLoggerRoute(uint16_t nLogger, size_t nOutput, bool bAdd);
 
-            void Flush(const std::stringstream& ssLog, Level level, const std::string& sPrefix);
+            bool UseRecordPool(uint32_t nSlots, size_t nCapacity);
+            detail::RecordPool* GetRecordPool() const { return m_pPool.load(std::memory_order_acquire); }
+
+            bool FlushAll(std::chrono::milliseconds timeout);
+            bool WaitUntilDurable(std::chrono::milliseconds timeout);
+
+            void SetThreadConfig(const ThreadConfig& config);
+            ThreadConfig GetThreadConfig();
+            friend void ApplyThreadConfig(const std::string& sName);
 
             void Loop();
 
             void Stop();
 
-            void HandleActionQueue();
+            bool HandleQueue();
+            size_t Dequeue();
+            void Wake();
+            bool WaitForSequence(std::vector<uint64_t> vTargets, bool bDurable, std::chrono::milliseconds timeout);
+
+            static void DoApplyThreadConfig(const ThreadConfig& config, const std::string& sName);
+
+            /** @brief an immutable set of outputs and their levels. A new one is published every time the outputs, their levels or the logger routes are changed and the Manager thread picks it up at the start of each batch
+            **/
+            struct outputSet
+            {
+                struct route
+                {
+                    size_t nWord;       ///< the word of the logger masks that holds the output's bit
+                    uint64_t nBit;      ///< the output's bit in that word
+                    Output* pOutput;
+                    Level level;                        ///< the output level when the set was built
+                    std::vector<int8_t> vPrefixLevels;  ///< level+1 for each prefix id up to the last one the output has a level for, 0 means use level
+
+                    bool Accepts(Level msgLevel, uint16_t nPrefix) const
+                    {
+                        auto nLevel = nPrefix < vPrefixLevels.size() ? vPrefixLevels[nPrefix] : 0;
+                        return nLevel != 0 ? static_cast<int>(msgLevel) >= nLevel-1 : msgLevel >= level;
+                    }
+                };
+
+                std::map<size_t, std::shared_ptr<Output>> mOutputs;
+                std::vector<route> vRoutes;         ///< the outputs in mOutputs order
+                size_t nWords = 0;                  ///< the number of 64 bit words in each logger's mask, enough for one bit per output
+                std::vector<uint64_t> vMasks;       ///< the outputs each logger routes to, nWords words per logger id
+
+                bool RoutesTo(size_t nLogger, const route& aRoute) const { return nLogger*nWords >= vMasks.size() || (vMasks[nLogger*nWords+aRoute.nWord] & aRoute.nBit) != 0; }
+            };
+
+            /** @brief the settings of a logger. The default logger is entry 0
+            **/
+            struct loggerConfig
+            {
+                Level level = Level::kTrace;
+                std::optional<std::set<size_t>> routes;     ///< the ids of the outputs the logger routes to. Every output if not set
+
+                bool RoutesTo(size_t nOutput) const { return !routes || routes->count(nOutput) != 0; }
+            };
+
+            /** @brief the levels the producers check before they queue a message, worked out from an outputSet and the logger levels
+            **/
+            struct minLevels
+            {
+                int nMin = kNoOutputs;              ///< the lowest level that any output will accept
+                int nFloor = kNoOutputs;            ///< the lowest level that any output will accept for any prefix
+                std::vector<int8_t> vPrefix;        ///< level+1 that any output will accept for each prefix, 0 means use nMin
+                std::vector<int8_t> vLogger;        ///< the lowest level that each logger and any of its outputs will accept
+                std::vector<bool> vCheckOutputs;    ///< whether each logger's level is only a bound
+
+                void Lower(const minLevels& other);
+            };
+
+            void Publish(std::shared_ptr<outputSet> pOutputs);
+            minLevels CalculateMinLevel(const outputSet& outputs) const;
+            void StoreMinLevel(const minLevels& levels);
+            void CalculateRoutes(outputSet& outputs) const;
+            void RepublishRoutes();
+
+            std::mutex m_mutexControl;                      ///< serializes changes to the outputs. Never taken by the logging path
+            size_t m_nOutputIdGenerator;                    ///< protected by m_mutexControl
+            std::shared_ptr<const outputSet> m_pOutputs;    ///< only accessed through std::atomic_load/std::atomic_store
+
+            static constexpr int kNoOutputs = static_cast<int>(Level::kCritical)+1;
+            std::atomic<int> m_nMinLevel{kNoOutputs};       ///< the lowest level that any output will accept
+            std::array<std::atomic<int8_t>, Prefix::kMaxPrefixes> m_aPrefixMinLevel{};  ///< level+1 that any output will accept for each prefix, 0 means use m_nMinLevel
 
-            void DoAddOutput(std::unique_ptr<Output> pLogout, size_t nId);
-            void DoSetOutputLevel(size_t nIndex, Level level);
-            void DoSetOutputLevel(Level level);
-            void DoRemoveOutput(size_t nIndex);
+            std::unordered_map<std::string, uint16_t> m_mLoggerIds;     ///< protected by m_mutexControl
+            std::vector<loggerConfig> m_vLoggers{1};                    ///< protected by m_mutexControl. Indexed by logger id
+            std::array<std::atomic<int8_t>, Logger::kMaxLoggers> m_aLoggerMinLevel{};  ///< the lowest level that the logger and any of its outputs will accept
+            std::array<std::atomic_bool, Logger::kMaxLoggers> m_aLoggerCheckOutputs{};    ///< true if m_aLoggerMinLevel is only a bound and IsEnabled must ask the logger's outputs
 
-            std::map<size_t, std::unique_ptr<Output>> m_mOutput;
-            size_t m_nOutputIdGenerator;
+            std::shared_ptr<const outputSet> m_pBatchOutputs;   ///< the outputs in use for the current batch. Manager thread only
 
+            ThreadConfig m_threadConfig;                    ///< protected by m_mutexControl
+            std::atomic_bool m_bThreadConfigChanged{false};
 
-            struct logEntry
+            /** @brief a queued log message, laid out to fill four cache lines. Messages of the length most lines are (up to about 200 characters) are held in aInline and longer ones in pHeap or a record pool slot.
+            *   The prefix is normally just its id. If it could not be registered its name is stored in front of the message
+            **/
+            struct alignas(64) record
             {
-                //needed to allow action to be default constructible for the concurrent queue
-                logEntry()=default;
-                ~logEntry()=default;
-                logEntry(const std::string& ss, Level e, const std::string& s) :
-                    sLog(ss), level(e), sPrefix(s){}
-
-                std::string sLog;
-                Level level;
-                std::string sPrefix;
+                enum class Type : uint8_t { kEntry, kWake };
+
+                static constexpr size_t kSize = 256;
+                static constexpr size_t kInline = detail::MessageBuffer::kInlineCapacity;
+
+                record() = default;
+                record(Type t, Level e, uint16_t nP, uint64_t nSeq) : nSequence(nSeq), nPrefix(nP), eType(t), nLevel(static_cast<uint8_t>(e)){}
+                record(record&& other) noexcept { *this = std::move(other); }
+                record& operator=(record&& other) noexcept;
+
+                const char* GetData() const { return pHeap ? pHeap.get() : aInline; }
+
+                uint64_t nSequence = 0;                         ///< the entry's place in its shard
+                int64_t nTime = 0;                              ///< system_clock time in ns when the message was flushed
+                uint32_t nSlot = detail::RecordPool::kNoSlot;   ///< the record pool slot holding the message
+                uint32_t nLength = 0;                           ///< the length of the message
+                uint16_t nPrefix = 0;
+                uint16_t nPrefixLength = 0;                     ///< the length of the unregistered prefix name in front of the message
+                Type eType = Type::kEntry;
+                uint8_t nLevel = 0;
+                uint16_t nLogger = 0;
+                std::unique_ptr<char[]> pHeap;
+                detail::ContextPtr pContext;                    ///< the diagnostic context of the thread that flushed the message
+                char aInline[kInline];
             };
+            static_assert(sizeof(record) == record::kSize, "record should fill four cache lines");
 
-            struct action
+            /** @brief a queue of records and the sequence numbers of the entries put on it. A producer thread always uses the same shard so the queue keeps its entries in order,
+            *   and producers in different shards never touch the same cache lines
+            **/
+            struct shard
             {
-                enum class Type { kAddOutput, kSetOutputLevel, kRemoveOutput, kSetAllOutputLevel, kEntry };
-                action() = default;
-
-                action(Type type, size_t index, Level lv, std::unique_ptr<Output> p) : eType(type), nIndex(index), level(lv), pLogout(std::move(p)){}
-
-                explicit action(const logEntry& e) : eType(Type::kEntry), entry(e){}
-                               
-                
-                Type eType;
-                size_t nIndex;
-                Level level{Level::kTrace};
-                std::unique_ptr<Output> pLogout{nullptr};
-                logEntry entry;
+                explicit shard(size_t nCapacity) : qRecord(nCapacity){}
+
+                moodycamel::ConcurrentQueue<record> qRecord;
+                alignas(64) std::atomic<uint64_t> nSequence{0};     ///< next sequence number to hand to an entry. Producers only touch this
+                alignas(64) uint64_t nCompleted = 0;                ///< all entries with a sequence below this have been output. Manager thread only
+                uint64_t nCommitted = 0;                            ///< nCompleted when the outputs were last committed. Manager thread only
+                uint64_t nFailedFrom = 0;                           ///< the entries from nFailedFrom up to nFailedTo were in the last batch an output could not commit. Manager thread only
+                uint64_t nFailedTo = 0;
+                std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> pqCompleted;   ///< entries completed out of order. Manager thread only
             };
 
-            void LogAction(const logEntry& entry);
+            /** @brief a FlushAll or WaitUntilDurable call waiting, in each shard, for all entries with a sequence number below the target for that shard to be output
+            **/
+            struct barrier
+            {
+                std::vector<uint64_t> vTargets;
+                bool bDurable;      ///< WaitUntilDurable, which fails if the last entry it waits for was in a batch that could not be committed
+                std::shared_ptr<std::promise<bool>> pPromise;
+            };
+
+            void LogRecord(const record& rec);
+            void LogMerged(size_t nCount);
+            void MessagesDone();
+
+            size_t GetShard();
+            size_t TakeRecords();
+            void Completed(shard& aShard, uint64_t nSequence);
+            void CollectDropped();
+            void CheckBarriers(bool bFinal);
+            bool IsCommitted(const barrier& aBarrier) const;
+
+            static constexpr size_t kDefaultQueueCapacity = 6*32;     ///< the queue's own default of 6 blocks
+            static constexpr size_t kSpins = 1024;                      ///< the number of times the queue is polled between pause instructions before yielding in ConsumerMode::kBusyPoll
+            static constexpr std::chrono::milliseconds kSleep{100};     ///< the longest the Manager thread sleeps before checking for barriers, thread config changes and being stopped
+            std::vector<std::unique_ptr<shard>> m_vShards;              ///< never changed once the Manager has been created
+            moodycamel::LightweightSemaphore m_semaphore;               ///< only signalled while the Manager thread is sleeping, so producers do not pay for a wake up while it is busy or polling
+            alignas(64) std::atomic_bool m_bSleeping{false};
 
-            moodycamel::BlockingConcurrentQueue<action> m_qAction;
+            std::atomic<size_t> m_nNextShard{0};        ///< the shard the next thread to log is given
 
-            std::unique_ptr<std::thread> m_pThread = nullptr;
-            std::atomic_bool m_bRun{true};
+            std::mutex m_mutexDropped;                  ///< only taken when the queue refuses an entry
+            std::vector<std::pair<size_t, uint64_t>> m_vDropped;    ///< the shard and sequence number of each dropped entry
+            std::atomic_bool m_bDropped{false};
+
+            std::vector<barrier> m_vBarriers;           ///< Manager thread only
+
+            std::mutex m_mutexBarriers;                 ///< only taken by FlushAll and when it has added a barrier
+            std::vector<barrier> m_vNewBarriers;
+            std::atomic_bool m_bNewBarriers{false};
+
+            static constexpr size_t kBatchSize = 64;
+            static constexpr size_t kMaxBatches = 16;           ///< the most batches that are taken from the queue before the outputs are flushed and committed
+            std::vector<record> m_vRecords;             ///< kBatchSize for each shard. Manager thread only
+            std::vector<size_t> m_vShardEnd;            ///< where each shard's records end in m_vRecords. Manager thread only
+            std::vector<uint32_t> m_vOrder;             ///< the order to output m_vRecords in when there is more than one shard. Manager thread only
+
+            detail::Renderer m_renderer;                        ///< Manager thread only
+            std::unique_ptr<detail::RecordPool> m_pPoolOwner;   ///< protected by m_mutexControl. Never replaced once created
+            std::atomic<detail::RecordPool*> m_pPool{nullptr};
+            std::string m_sMessage;                             ///< reused to pass messages to the outputs so that it keeps its capacity. Manager thread only
+            std::string m_sPrefix;                              ///< reused to pass unregistered prefixes to the outputs. Manager thread only
+
+            ConsumerMode m_consumer = ConsumerMode::kBlocking;     ///< set before the thread starts
+            std::chrono::microseconds m_busyPollIdle{1000};     ///< set before the thread starts
+            std::unique_ptr<std::thread> m_pThread = nullptr;   ///< protected by m_mutexControl
+            bool m_bStopped = false;                            ///< protected by m_mutexControl. The thread is not started again once stopped
+            std::atomic_bool m_bStarted{false};
+            std::atomic_bool m_bRun{false};
 
     };
 }
 
 #endif
-
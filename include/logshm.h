@@ -0,0 +1,48 @@
+#ifndef PML_LOG_SHM_H
+#define PML_LOG_SHM_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace pml::log
+{
+    /** @brief The layout of the shared memory segment that a SharedMemory output writes and a Collector reads. Each producer has its own segment named
+    *   /pml_log.<channel>.<pid>.<n>: a ShmHeader followed by a ring of nCapacity bytes holding ShmRecords. Only the producer moves nHead and only the collector moves nTail,
+    *   so the ring needs no locks and neither side ever waits for the other
+    **/
+    struct ShmHeader
+    {
+        static constexpr uint64_t kMagic = 0x31'4d'48'53'4c'4d'50;     ///< "PMLSHM1"
+        static constexpr uint64_t kSize = 256;                          ///< the ring starts this far into the segment
+
+        std::atomic<uint64_t> nMagic;               ///< written last so a collector never reads a segment that is still being set up
+        uint64_t nCapacity;                         ///< the size of the ring in bytes. A power of 2
+        int64_t nPid;                               ///< the producer process
+        alignas(64) std::atomic<uint64_t> nHead;    ///< the number of bytes the producer has written. Published at the end of each batch
+        std::atomic<uint64_t> nDropped;             ///< the number of messages the producer dropped because the ring was full
+        std::atomic<uint32_t> nClosed;              ///< set once the producer will not write any more
+        alignas(64) std::atomic<uint64_t> nTail;    ///< the number of bytes the collector has read
+        std::atomic<int64_t> nCollectorSeen;        ///< steady_clock time in ns when a collector last read the ring. 0 if none ever has
+    };
+
+    /** @brief A message in the ring. It is followed by the prefix, the context and then the message. The context is each key and value in turn, each one a uint16_t length and then the characters
+    **/
+    struct ShmRecord
+    {
+        static constexpr uint32_t kPadding = 0xFFFFFFFF;    ///< nLength of the marker written when the next record does not fit before the end of the ring. The rest of the ring is skipped
+
+        uint32_t nLength;           ///< the length of the whole record, a multiple of 8
+        uint32_t nMessageLength;
+        uint32_t nContextLength;
+        uint16_t nPrefixLength;
+        uint8_t nLevel;
+        uint8_t nReserved;
+        int64_t nTime;              ///< system_clock time of the message in ns since the epoch
+    };
+
+    static_assert(sizeof(ShmHeader) <= ShmHeader::kSize && sizeof(ShmRecord) == 24, "shared memory layout must not depend on the compiler");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<int64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                  "the ring is shared between processes so its atomics must not use locks");
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef PML_LOG_ASYNCFILE_H
+#define PML_LOG_ASYNCFILE_H
+
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "dlllog.h"
+#include "log.h"
+
+#ifdef __linux__
+namespace pml::log
+{
+    namespace detail
+    {
+        class AsyncWriter;
+    }
+
+    /** @brief Output class that writes the same hourly YYYY-MM-DDTHH.log files as File but never blocks the Manager thread on the disk.
+    *   Messages are copied in to a small set of fixed buffers and full buffers are written, and files opened and closed, through io_uring so the Manager thread only
+    *   submits work and collects completions. Only when every buffer is waiting for the disk does the Manager thread wait.
+    *   If the kernel does not support io_uring (or it is blocked) the buffers are written synchronously with pwrite instead
+    **/
+    class LOG_EXPORT AsyncFile : public Output
+    {
+        public:
+            /** @brief Constructor
+            *   @param rootPath - the root path that the log files should live in.
+            *   @param nTimestamp - the format of the timestamp that gets written in to the log
+            *   @param resolution - the resolution of the timestamp
+            *   @param bLocalTime - whether to use local time or UTC time for the file names
+            *   @param nBuffers - the number of buffers and so the maximum number of writes that can be in flight at once
+            *   @param nBufferSize - the size of each buffer in bytes
+            **/
+            AsyncFile(const std::filesystem::path& rootPath, int nTimestamp=kTsTime, TS resolution=TS::kMillisecond, bool bLocalTime=true,
+                      size_t nBuffers=8, size_t nBufferSize=64*1024);
+            virtual ~AsyncFile();
+
+            /** @brief Gets whether the files are being written with io_uring
+            *   @return <i>bool</i> true if io_uring is being used, false if the synchronous fallback is
+            **/
+            bool IsUsingIoUring() const;
+
+            /** @brief Gets the number of writes that failed or were cut short
+            *   @return <i>uint64_t</i> the number of failed writes
+            **/
+            uint64_t GetErrors() const;
+
+        private:
+            void DoOutputMessage(Level level, const std::string&  sLog, const std::string& sPrefix) override;
+            void Flush() override;
+            bool Commit(Durability durability) override;
+
+            std::filesystem::path m_rootPath;
+            std::string m_sCurrentFile;
+            bool m_bLocalTime = true;
+            std::unique_ptr<detail::AsyncWriter> m_pWriter;
+    };
+}
+#endif
+
+#endif
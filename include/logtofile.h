@@ -6,6 +6,7 @@
 
 #include "dlllog.h"
 #include "log.h"
+#include "logindex.h"
 
 #if ((defined(_MSVC_LANG) && _MSVC_LANG >=201703L) || __cplusplus >= 201703L)
 #include <filesystem>
@@ -23,21 +24,41 @@ namespace pml::log
             *   @param bLocalTime - whether to use local time or UTC time for the timestamp
             **/
            File(const std::filesystem::path& rootPath, int nTimestamp=kTsTime, TS resolution=TS::kMillisecond, bool bLocalTime=true);
-            virtual ~File(){}
+            virtual ~File();
+
+            /** @brief Write a sidecar index (YYYY-MM-DDTHH.idx) next to each log file. The index holds the byte offset of each interval of messages and the number of messages
+            *   of each level in it so that pml_log_query can seek straight to a time range. Should be called before the File is added to the Stream
+            *   @param interval - the length of time each block of the index covers. 0 turns indexing off
+            **/
+            void SetIndexInterval(std::chrono::seconds interval);
 
 
         private:
 
             void DoOutputMessage(Level level, const std::string&  logStream, const std::string& sPrefix) override;
             void Flush() override;
+            bool Commit(Durability durability) override;
 
-            void OpenFile(const std::string& sFileName);
+            void OpenFile(const std::string& sFileName, time_t hour);
+            bool Sync();
+            void CloseSyncFd();
+            void OpenIndex(const std::string& sFileName, time_t hour);
+            void WriteIndexBlock();
 
             std::filesystem::path m_rootPath;
             std::string m_sCurrentFile;
             bool m_bLocalTime = true;
             std::ofstream m_ofLog;
             bool m_bOk = true;
+            bool m_bCommitFailed = false;           ///< a message since the last commit could not be written to the file or synced
+
+            uint64_t m_nOffset = 0;                 ///< the size of the current log file
+            std::chrono::seconds m_indexInterval{0};
+            std::ofstream m_ofIndex;
+            IndexBlock m_block{};
+            bool m_bBlockOpen = false;
+
+            int m_nSyncFd = -1;     ///< a second descriptor for the current file used for fdatasync as std::ofstream does not expose its own
     };
 }
 #else
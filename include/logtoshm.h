@@ -0,0 +1,61 @@
+#ifndef PML_LOG_TOSHM_H
+#define PML_LOG_TOSHM_H
+
+#include <chrono>
+#include <string>
+
+#include "dlllog.h"
+#include "log.h"
+
+#ifdef __linux__
+namespace pml::log
+{
+    struct ShmHeader;
+
+    /** @brief Output class that hands the messages to a Collector in another process through a ring in shared memory, so that many processes on a host can share one set of log files.
+    *   Writing a message is a copy in to the ring and the ring is published once per batch. If the collector is not running, has died or cannot keep up the ring fills up
+    *   and further messages are dropped and counted: the output never waits for the collector
+    **/
+    class LOG_EXPORT SharedMemory : public Output
+    {
+        public:
+            /** @brief Constructor - creates the shared memory segment
+            *   @param sChannel the name that the collector is started with. Must not contain '/'
+            *   @param nCapacity the size of the ring in bytes. Rounded up to a power of 2
+            **/
+            explicit SharedMemory(const std::string& sChannel, size_t nCapacity=4*1024*1024);
+            virtual ~SharedMemory();
+
+            /** @brief Gets whether the shared memory segment was created
+            *   @return <i>bool</i> true if it was, false if not in which case every message is dropped
+            **/
+            bool IsOpen() const { return m_pHeader != nullptr; }
+
+            /** @brief Gets the number of messages dropped because the ring was full
+            *   @return <i>uint64_t</i> the number of dropped messages
+            **/
+            uint64_t GetDropped() const;
+
+            /** @brief Gets whether a collector has read the ring recently
+            *   @param timeout how recently
+            *   @return <i>bool</i> true if a collector has read the ring within the timeout
+            **/
+            bool IsCollectorAlive(std::chrono::milliseconds timeout=std::chrono::milliseconds(2000)) const;
+
+        private:
+            void DoOutputMessage(Level level, const std::string&  sLog, const std::string& sPrefix) override;
+            void Flush() override;
+
+            void Write(const void* pData, size_t nLength);
+
+            std::string m_sName;
+            ShmHeader* m_pHeader = nullptr;
+            char* m_pRing = nullptr;
+            uint64_t m_nCapacity = 0;
+            uint64_t m_nHead = 0;       ///< the bytes written, which are published in Flush
+            uint64_t m_nDropped = 0;    ///< the number of messages dropped if the segment could not be created
+    };
+}
+#endif
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef PML_LOG_SYSLOG_H
+#define PML_LOG_SYSLOG_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "dlllog.h"
+#include "log.h"
+
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
+#ifdef __linux__
+namespace pml::log
+{
+    /** @brief Output class that sends the log straight to the local syslog daemon (RFC 5424) or the systemd journal over their Unix domain datagram sockets.
+    *   All the messages in a Manager batch are sent with a single sendmmsg call when the Output is flushed. The socket is non-blocking: if it is full or missing the messages are dropped and counted rather than holding up the Manager thread
+    **/
+    class LOG_EXPORT Syslog : public Output
+    {
+        public:
+            enum class Protocol { kSyslog, kJournald };
+
+            static const std::string kSyslogSocket;     ///< /dev/log
+            static const std::string kJournaldSocket;   ///< /run/systemd/journal/socket
+
+            /** @brief Constructor
+            *   @param protocol whether to send RFC 5424 syslog messages or native journald messages
+            *   @param sIdentifier the APP-NAME or SYSLOG_IDENTIFIER. If empty the program name is used
+            *   @param nFacility the syslog facility (default 1 - user-level messages)
+            *   @param sSocketPath the socket to send to. If empty the default for the protocol is used
+            **/
+            explicit Syslog(Protocol protocol=Protocol::kSyslog, const std::string& sIdentifier="", int nFacility=1, const std::string& sSocketPath="");
+            virtual ~Syslog();
+
+            /** @brief Gets the number of messages that have been dropped because the socket was full or missing
+            *   @return <i>size_t</i> the number of dropped messages
+            **/
+            size_t GetDropped() const { return m_nDropped.load(std::memory_order_relaxed); }
+
+            /** @brief Maps a log level to a syslog severity
+            *   @param level the level
+            *   @return <i>int</i> the severity
+            **/
+            static int GetSeverity(Level level);
+
+        private:
+            void DoOutputMessage(Level level, const std::string&  sLog, const std::string& sPrefix) override;
+            void Flush() override;
+
+            bool Connect();
+            void Disconnect();
+
+            void AddSyslogDatagram(Level level, const std::string&  sLog, const std::string& sPrefix);
+            void AddJournaldDatagram(Level level, const std::string&  sLog, const std::string& sPrefix);
+            std::string& NextDatagram();
+            void RenderContext();
+
+            Protocol m_protocol;
+            std::string m_sIdentifier;
+            int m_nFacility;
+            std::string m_sSocketPath;
+            std::string m_sHostname;
+            std::string m_sPid;
+
+            int m_nSocket = -1;
+            std::chrono::steady_clock::time_point m_tpRetry;
+
+            std::vector<std::string> m_vDatagrams;  ///< kept between batches so the strings' buffers get reused
+            size_t m_nPending = 0;
+            std::vector<iovec> m_vIov;      ///< kept between batches along with m_vMsg so that Flush does not allocate
+            std::vector<mmsghdr> m_vMsg;
+            std::atomic<size_t> m_nDropped{0};     ///< written by the Manager thread and read by GetDropped from any thread
+
+            uint64_t m_nContextVersion = 0;     ///< the version of the Context that m_sContext was rendered from
+            std::string m_sContext;             ///< the context as RFC 5424 structured data or journald fields
+
+            static constexpr std::chrono::seconds kRetryInterval{5};
+    };
+}
+#endif
+
+#endif
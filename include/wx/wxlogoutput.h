@@ -1,21 +1,98 @@
 #pragma once
 #include "log.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <fstream>
+#include <vector>
 #include <wx/event.h>
 
+/** @brief a log message held by wxLogOutput when it is batching messages. Its prefix and message are in the text of the wxLogBatch it belongs to
+**/
+struct wxLogRecord
+{
+    std::chrono::system_clock::time_point tp;
+    pml::log::Level level;
+    uint32_t nOffset;           ///< where the prefix starts in the batch's text. The message follows it
+    uint32_t nPrefixLength;
+    uint32_t nLength;           ///< the length of the message
+};
+
+/** @brief the messages carried by a wxLogBatchEvent. The prefixes and messages are held one after another in a single string so a message does not need its own allocations
+**/
+struct wxLogBatch
+{
+    std::vector<wxLogRecord> vRecords;
+    std::string sText;
+};
+
+struct wxLogBatchState;
+
+/** @brief event posted by wxLogOutput when batching. Carries all the messages output since the previous event
+**/
+class wxLogBatchEvent : public wxEvent
+{
+    public:
+        wxLogBatchEvent(std::shared_ptr<const wxLogBatch> pBatch, size_t nDropped, std::shared_ptr<void> pHandled);
+        wxEvent* Clone() const override { return new wxLogBatchEvent(*this); }
+
+        /** @brief Gets the messages
+        *   @return <i>std::vector<wxLogRecord></i> the messages, oldest first
+        **/
+        const std::vector<wxLogRecord>& GetRecords() const { return m_pBatch->vRecords; }
+
+        /** @brief Gets the prefix of one of the messages
+        *   @param record one of the records returned by GetRecords
+        *   @return <i>std::string_view</i> the prefix, valid for as long as the event or a copy of it exists
+        **/
+        std::string_view GetPrefix(const wxLogRecord& record) const { return std::string_view(m_pBatch->sText).substr(record.nOffset, record.nPrefixLength); }
+
+        /** @brief Gets the text of one of the messages
+        *   @param record one of the records returned by GetRecords
+        *   @return <i>std::string_view</i> the message, valid for as long as the event or a copy of it exists
+        **/
+        std::string_view GetMessage(const wxLogRecord& record) const { return std::string_view(m_pBatch->sText).substr(record.nOffset+record.nPrefixLength, record.nLength); }
+
+        /** @brief Gets the number of messages thrown away since the previous event because the GUI was not keeping up
+        *   @return <i>size_t</i> the number of messages
+        **/
+        size_t GetDropped() const { return m_nDropped; }
+
+    private:
+        std::shared_ptr<const wxLogBatch> m_pBatch;     ///< shared by the copies of the event
+        size_t m_nDropped;
+        std::shared_ptr<void> m_pHandled;   ///< released once this event and its copies have been handled and destroyed, which lets the wxLogOutput post the next event
+};
+
 class wxLogOutput : public pml::log::Output
 {
     public:
         explicit wxLogOutput(wxEvtHandler* pHandler, bool bMilliseconds=false);
-        virtual ~wxLogOutput(){}
+        virtual ~wxLogOutput();
         void DoOutputMessage(pml::log::Level level, const std::string&  sLog, const std::string& sPrefix) override;
 
+        /** @brief Collects messages and posts them as a single wxLogBatchEvent instead of a wxEVT_LOG event per message.
+        *   Only one event is outstanding at a time. Messages that arrive while it is waiting to be handled are posted as soon as it has been, and no sooner than the interval after the last event.
+        *   Can be called at any time
+        *   @param interval the minimum time between events. 0 means post at every flush
+        *   @param nMaxPending the most messages to hold while waiting for the GUI. The oldest are dropped beyond this
+        **/
+        void SetBatching(std::chrono::milliseconds interval=std::chrono::milliseconds(0), size_t nMaxPending=10000);
+
+    protected:
+        void Flush() override;
+
     private:
         wxEvtHandler* m_pHandler;
+
+        std::atomic_bool m_bBatching{false};
+        wxLogBatch m_batch;                             ///< the messages from the current Manager batch. Manager thread only
+        std::shared_ptr<wxLogBatchState> m_pBatch;      ///< shared with the GUI thread, which posts the next event when the last one has been handled
 };
 
 wxDECLARE_EXPORTED_EVENT(WXEXPORT, wxEVT_LOG, wxCommandEvent);
-
-
-
+wxDECLARE_EXPORTED_EVENT(WXEXPORT, wxEVT_LOG_BATCH, wxLogBatchEvent);
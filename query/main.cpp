@@ -0,0 +1,397 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logindex.h"
+
+/** @brief pml_log_query searches the hourly YYYY-MM-DDTHH.log files written by pml::log::File. Only the files that overlap the requested time range are opened.
+*   Where a file has a sidecar index only the blocks that overlap the time range and contain messages at or above the requested level are scanned.
+*   Files are memory mapped and scanned in parallel and the matching lines are written to stdout in time order
+**/
+
+namespace
+{
+    const char* const kLevels[pml::log::IndexBlock::kLevels] = {"TRACE", "DEBUG", "INFO", "WARNING", "ERROR", "CRITICAL"};
+
+    struct query
+    {
+        std::filesystem::path path;
+        time_t from = 0;
+        time_t to = std::numeric_limits<time_t>::max();
+        int nLevel = 0;
+        std::string sPrefix;
+        bool bUtc = false;
+        bool bStats = false;
+        unsigned int nThreads = std::max(1u, std::thread::hardware_concurrency());
+    };
+
+    struct logFile
+    {
+        std::filesystem::path path;
+        time_t hour = 0;
+        std::string sResult;
+        uint64_t nScanned = 0;
+        uint64_t nSize = 0;
+        bool bIndexed = false;
+    };
+
+    struct span
+    {
+        uint64_t nStart;
+        uint64_t nEnd;
+    };
+
+    void Usage()
+    {
+        std::cerr << "Usage: pml_log_query [options] <log directory>\n"
+                  << "  --from <YYYY-MM-DDTHH:MM[:SS]>   only show messages at or after this time\n"
+                  << "  --to <YYYY-MM-DDTHH:MM[:SS]>     only show messages before this time\n"
+                  << "  --level <level>                  only show messages at or above this level (trace, debug, info, warning, error, critical)\n"
+                  << "  --prefix <prefix>                only show messages with this prefix\n"
+                  << "  --utc                            times and file names are in UTC rather than local time\n"
+                  << "  --threads <n>                    number of files to scan at the same time\n"
+                  << "  --stats                          write the number of bytes scanned to stderr\n";
+    }
+
+    time_t MakeTime(tm& tmTime, bool bUtc)
+    {
+        tmTime.tm_isdst = -1;
+        return bUtc ? timegm(&tmTime) : mktime(&tmTime);
+    }
+
+    bool ParseTime(const std::string& sTime, bool bUtc, time_t& result)
+    {
+        tm tmTime{};
+        char cSeparator = 0;
+        int nRead = std::sscanf(sTime.c_str(), "%d-%d-%d%c%d:%d:%d", &tmTime.tm_year, &tmTime.tm_mon, &tmTime.tm_mday, &cSeparator,
+                                &tmTime.tm_hour, &tmTime.tm_min, &tmTime.tm_sec);
+        if(nRead < 3 || (nRead > 3 && cSeparator != 'T' && cSeparator != ' '))
+        {
+            return false;
+        }
+        tmTime.tm_year -= 1900;
+        tmTime.tm_mon -= 1;
+        result = MakeTime(tmTime, bUtc);
+        return result != -1;
+    }
+
+    int ParseLevel(std::string_view sLevel)
+    {
+        for(int i = 0; i < pml::log::IndexBlock::kLevels; i++)
+        {
+            if(sLevel.size() == std::strlen(kLevels[i]) &&
+               std::equal(sLevel.begin(), sLevel.end(), kLevels[i], [](char a, char b){ return std::toupper(static_cast<unsigned char>(a)) == b; }))
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /** @brief returns the start of the hour the file covers from a name of the form YYYY-MM-DDTHH.log or -1 if the file is not a log file
+    **/
+    time_t ParseFileName(const std::filesystem::path& path, bool bUtc)
+    {
+        auto sName = path.filename().string();
+        tm tmTime{};
+        int nLength = 0;
+        if(sName.size() != 17 || path.extension() != ".log" ||
+           std::sscanf(sName.c_str(), "%4d-%2d-%2dT%2d.log%n", &tmTime.tm_year, &tmTime.tm_mon, &tmTime.tm_mday, &tmTime.tm_hour, &nLength) != 4 || nLength != 17)
+        {
+            return -1;
+        }
+        tmTime.tm_year -= 1900;
+        tmTime.tm_mon -= 1;
+        return MakeTime(tmTime, bUtc);
+    }
+
+    /** @brief works out which parts of the file need scanning. With no usable index that is the whole file
+    **/
+    std::vector<span> GetSpans(logFile& file, const query& q)
+    {
+        auto idxPath = file.path;
+        idxPath.replace_extension(".idx");
+
+        std::ifstream ifIndex(idxPath, std::ios::binary);
+        pml::log::IndexHeader header{};
+        if(ifIndex.read(reinterpret_cast<char*>(&header), sizeof(header)).gcount() != sizeof(header) || header.IsValid() == false)
+        {
+            return {{0, file.nSize}};
+        }
+
+        file.hour = header.nHour;
+        file.bIndexed = true;
+
+        std::vector<span> vSpans;
+        auto addSpan = [&vSpans](uint64_t nStart, uint64_t nEnd)
+        {
+            if(vSpans.empty() == false && vSpans.back().nEnd == nStart)
+            {
+                vSpans.back().nEnd = nEnd;
+            }
+            else
+            {
+                vSpans.push_back({nStart, nEnd});
+            }
+        };
+
+        uint64_t nIndexed = 0;
+        pml::log::IndexBlock block;
+        while(ifIndex.read(reinterpret_cast<char*>(&block), sizeof(block)).gcount() == sizeof(block))
+        {
+            if(block.nOffset < nIndexed || block.nOffset+block.nLength > file.nSize)
+            {
+                //the index does not match the log file
+                return {{0, file.nSize}};
+            }
+
+            //anything between the blocks, such as messages written before the index was turned on, is not in the index so must be scanned
+            if(block.nOffset > nIndexed)
+            {
+                addSpan(nIndexed, block.nOffset);
+            }
+            nIndexed = block.nOffset+block.nLength;
+
+            if(block.nEnd > q.from && block.nStart < q.to && block.CountFrom(q.nLevel) != 0)
+            {
+                addSpan(block.nOffset, nIndexed);
+            }
+        }
+
+        //messages written after the last complete block are not in the index yet
+        if(nIndexed < file.nSize)
+        {
+            addSpan(nIndexed, file.nSize);
+        }
+        return vSpans;
+    }
+
+    /** @brief returns the minutes and seconds of a HH:MM:SS timestamp within the hour of the file, or -1 if the field doesn't contain one
+    **/
+    int ParseSecondOfHour(std::string_view sField)
+    {
+        for(size_t i = 0; i+8 <= sField.size(); i++)
+        {
+            auto s = sField.substr(i, 8);
+            if(s[2] == ':' && s[5] == ':' && std::isdigit(static_cast<unsigned char>(s[3])) && std::isdigit(static_cast<unsigned char>(s[4])) &&
+               std::isdigit(static_cast<unsigned char>(s[6])) && std::isdigit(static_cast<unsigned char>(s[7])))
+            {
+                return ((s[3]-'0')*10 + (s[4]-'0'))*60 + (s[6]-'0')*10 + (s[7]-'0');
+            }
+        }
+        return -1;
+    }
+
+    /** @brief checks a line of the form [timestamp\t]LEVEL\t[prefix]\tmessage. Returns 1 if it matches, 0 if it doesn't and -1 if it is not the start of a message
+    **/
+    int MatchLine(std::string_view sLine, time_t hour, const query& q)
+    {
+        auto nTab = sLine.find('\t');
+        if(nTab == std::string_view::npos)
+        {
+            return -1;
+        }
+
+        int nSecond = -1;
+        auto nLevel = ParseLevel(sLine.substr(0, nTab));
+        if(nLevel == -1)
+        {
+            nSecond = ParseSecondOfHour(sLine.substr(0, nTab));
+            sLine.remove_prefix(nTab+1);
+            nTab = sLine.find('\t');
+            if(nTab == std::string_view::npos || (nLevel = ParseLevel(sLine.substr(0, nTab))) == -1)
+            {
+                return -1;
+            }
+        }
+        sLine.remove_prefix(nTab+1);
+
+        if(nLevel < q.nLevel)
+        {
+            return 0;
+        }
+        if(nSecond != -1 && (hour+nSecond < q.from || hour+nSecond >= q.to))
+        {
+            return 0;
+        }
+        if(q.sPrefix.empty() == false)
+        {
+            if(sLine.size() < q.sPrefix.size()+2 || sLine[0] != '[' || sLine.compare(1, q.sPrefix.size(), q.sPrefix) != 0 || sLine[q.sPrefix.size()+1] != ']')
+            {
+                return 0;
+            }
+        }
+        return 1;
+    }
+
+    void ScanFile(logFile& file, const query& q)
+    {
+        int fd = open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd == -1)
+        {
+            std::cerr << "Could not open " << file.path << ": " << std::strerror(errno) << std::endl;
+            return;
+        }
+
+        struct stat info;
+        if(fstat(fd, &info) != 0 || info.st_size == 0)
+        {
+            close(fd);
+            return;
+        }
+        file.nSize = static_cast<uint64_t>(info.st_size);
+
+        auto pMap = mmap(nullptr, file.nSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(pMap == MAP_FAILED)
+        {
+            std::cerr << "Could not map " << file.path << ": " << std::strerror(errno) << std::endl;
+            return;
+        }
+
+        auto vSpans = GetSpans(file, q);
+        auto pData = static_cast<const char*>(pMap);
+        auto nPageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        for(const auto& aSpan : vSpans)
+        {
+            auto nPage = aSpan.nStart - aSpan.nStart%nPageSize;
+            madvise(static_cast<char*>(pMap)+nPage, aSpan.nEnd-nPage, MADV_SEQUENTIAL);
+
+            //lines that do not start a message belong to the message before them
+            bool bMatch = false;
+            for(auto nPos = aSpan.nStart; nPos < aSpan.nEnd;)
+            {
+                auto pEnd = static_cast<const char*>(std::memchr(pData+nPos, '\n', aSpan.nEnd-nPos));
+                auto nEnd = pEnd ? static_cast<uint64_t>(pEnd-pData)+1 : aSpan.nEnd;
+                std::string_view sLine(pData+nPos, nEnd-nPos);
+
+                if(auto nResult = MatchLine(sLine, file.hour, q); nResult != -1)
+                {
+                    bMatch = (nResult == 1);
+                }
+                if(bMatch)
+                {
+                    file.sResult.append(sLine);
+                    if(sLine.back() != '\n')
+                    {
+                        file.sResult.push_back('\n');
+                    }
+                }
+                nPos = nEnd;
+            }
+            file.nScanned += aSpan.nEnd-aSpan.nStart;
+        }
+
+        munmap(pMap, file.nSize);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    query q;
+    std::string sFrom, sTo;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string sArg(argv[i]);
+        bool bValue = i+1 < argc;
+        if(sArg == "--from" && bValue)          sFrom = argv[++i];
+        else if(sArg == "--to" && bValue)       sTo = argv[++i];
+        else if(sArg == "--prefix" && bValue)   q.sPrefix = argv[++i];
+        else if(sArg == "--utc")                q.bUtc = true;
+        else if(sArg == "--stats")              q.bStats = true;
+        else if(sArg == "--level" && bValue)
+        {
+            if((q.nLevel = ParseLevel(argv[++i])) == -1)
+            {
+                std::cerr << "Unknown level " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if(sArg == "--threads" && bValue)
+        {
+            q.nThreads = std::max(1, std::atoi(argv[++i]));
+        }
+        else if(sArg.empty() == false && sArg[0] != '-' && q.path.empty())
+        {
+            q.path = sArg;
+        }
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+
+    if(q.path.empty() || (sFrom.empty() == false && ParseTime(sFrom, q.bUtc, q.from) == false) || (sTo.empty() == false && ParseTime(sTo, q.bUtc, q.to) == false))
+    {
+        Usage();
+        return 1;
+    }
+
+    std::vector<logFile> vFiles;
+    std::error_code ec;
+    for(const auto& entry : std::filesystem::directory_iterator(q.path, ec))
+    {
+        if(auto hour = ParseFileName(entry.path(), q.bUtc); hour != -1 && hour+3600 > q.from && hour < q.to)
+        {
+            vFiles.push_back({entry.path(), hour, std::string(), 0, 0, false});
+        }
+    }
+    if(ec)
+    {
+        std::cerr << "Could not read " << q.path << ": " << ec.message() << std::endl;
+        return 1;
+    }
+    std::sort(vFiles.begin(), vFiles.end(), [](const auto& a, const auto& b){ return a.hour < b.hour; });
+
+    std::atomic<size_t> nNext{0};
+    std::vector<std::thread> vThreads;
+    for(unsigned int i = 0; i < std::min<size_t>(q.nThreads, vFiles.size()); i++)
+    {
+        vThreads.emplace_back([&]()
+        {
+            for(size_t nFile = nNext++; nFile < vFiles.size(); nFile = nNext++)
+            {
+                ScanFile(vFiles[nFile], q);
+            }
+        });
+    }
+    for(auto& th : vThreads)
+    {
+        th.join();
+    }
+
+    uint64_t nScanned = 0;
+    uint64_t nSize = 0;
+    size_t nIndexed = 0;
+    for(const auto& file : vFiles)
+    {
+        std::cout.write(file.sResult.data(), file.sResult.size());
+        nScanned += file.nScanned;
+        nSize += file.nSize;
+        nIndexed += file.bIndexed ? 1 : 0;
+    }
+    std::cout.flush();
+
+    if(q.bStats)
+    {
+        std::cerr << vFiles.size() << " files (" << nIndexed << " indexed), scanned " << nScanned << " of " << nSize << " bytes" << std::endl;
+    }
+    return 0;
+}
@@ -1,9 +1,18 @@
 #include "log.h"
 #include "logmanager.h"
 #include <iostream>
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <numeric>
 #include <iomanip>
 #include "log_version.h"
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
 
 
 
@@ -22,6 +31,11 @@ namespace pml::log
 {
     const std::string Stream::STR_LEVEL[6] = {"TRACE", "DEBUG", "INFO", "WARNING", "ERROR", "CRITICAL"};
 
+static thread_local uint64_t t_nLastSequence = 0;   ///< one more than the sequence number of the last message the thread flushed
+static thread_local bool t_bLastDropped = false;
+static thread_local size_t t_nShard = SIZE_MAX;     ///< the shard the thread puts its messages on. SIZE_MAX until it first logs
+static thread_local int64_t t_nLastTime = 0;        ///< the time of the last message the thread flushed, so that the thread's times never go backwards
+
 
 
 Stream log(Level level, const std::string& sPrefix)
@@ -54,6 +68,72 @@ Stream critical(const std::string& sPrefix)
     return Stream(Level::kCritical, sPrefix);
 }   
 
+Stream log(Level level, const Prefix& prefix)
+{
+    return Stream(level, prefix);
+}
+Stream trace(const Prefix& prefix)
+{
+    return Stream(Level::kTrace, prefix);
+}
+Stream debug(const Prefix& prefix)
+{
+    return Stream(Level::kDebug, prefix);
+}
+Stream info(const Prefix& prefix)
+{
+    return Stream(Level::kInfo, prefix);
+}
+Stream warning(const Prefix& prefix)
+{
+    return Stream(Level::kWarning, prefix);
+}
+Stream error(const Prefix& prefix)
+{
+    return Stream(Level::kError, prefix);
+}
+Stream critical(const Prefix& prefix)
+{
+    return Stream(Level::kCritical, prefix);
+}
+
+/** @brief tells the CPU this is a spin-wait loop so it can save power and let a hyper-threaded sibling run
+**/
+static inline void CpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static size_t g_nQueueCapacity = 0;     ///< set by Init before it creates the Manager
+static size_t g_nShards = 1;            ///< set by Init before it creates the Manager
+static std::once_flag g_onceSetup;      ///< run by Init to set the above, or with nothing by the Manager constructor if it is created first
+
+namespace detail
+{
+std::atomic<int> g_nFloorLevel{static_cast<int>(Level::kCritical)+1};
+}
+
+bool Init(Config config)
+{
+    auto bFirst = false;
+    std::call_once(g_onceSetup, [&]()
+    {
+        bFirst = true;
+        g_nQueueCapacity = config.nQueueCapacity;
+        g_nShards = config.nShards != 0 ? config.nShards : std::max(1u, std::thread::hardware_concurrency());
+    });
+    if(bFirst == false)
+    {
+        std::cout << "Could not initialise the log\tInit must be called once, before anything is logged" << std::endl;
+        return false;
+    }
+    return Manager::Get().Init(std::move(config));
+}
+
 Manager& Manager::Get()
 {
     static Manager lm;
@@ -62,11 +142,17 @@ Manager& Manager::Get()
 }
 
 
-Manager::Manager() : m_nOutputIdGenerator(0), m_pThread(nullptr)
+Manager::Manager() : m_nOutputIdGenerator(0), m_pOutputs(std::make_shared<outputSet>()), m_pThread(nullptr)
 {
-    // ensure the run flag is set before launching the thread
-    m_bRun = true;
-    m_pThread = std::make_unique<std::thread>([this]{Loop();});
+    //waits for an Init running on another thread to finish setting the globals, or stops a later Init from changing them
+    std::call_once(g_onceSetup, [](){});
+    for(size_t i = 0; i < g_nShards; i++)
+    {
+        m_vShards.push_back(std::make_unique<shard>(g_nQueueCapacity != 0 ? g_nQueueCapacity : kDefaultQueueCapacity));
+    }
+    m_vRecords.resize(kBatchSize*m_vShards.size());
+    m_vShardEnd.resize(m_vShards.size());
+    m_vOrder.reserve(m_vRecords.size());
 }
 
 Manager::~Manager()
@@ -74,139 +160,986 @@ Manager::~Manager()
     Stop();
 }
 
+bool Manager::Init(Config config)
+{
+    if(config.nPoolSlots != 0)
+    {
+        UseRecordPool(config.nPoolSlots, config.nPoolCapacity);
+    }
+    if(config.thread)
+    {
+        SetThreadConfig(*config.thread);
+    }
+
+    std::lock_guard<std::mutex> lg(m_mutexControl);
+    if(m_pThread == nullptr)
+    {
+        m_consumer = config.consumer;
+        m_busyPollIdle = config.busyPollIdle;
+    }
+    if(config.vOutputs.empty() == false)
+    {
+        auto pOutputs = std::make_shared<outputSet>(*std::atomic_load(&m_pOutputs));
+        for(auto& pOutput : config.vOutputs)
+        {
+            ++m_nOutputIdGenerator;
+            pOutputs->mOutputs.insert(std::make_pair(m_nOutputIdGenerator, std::shared_ptr<Output>(std::move(pOutput))));
+        }
+        Publish(std::move(pOutputs));
+        StartThread();
+    }
+    return true;
+}
+
+void Manager::StartThread()
+{
+    //called with m_mutexControl held
+    if(m_pThread == nullptr && m_bStopped == false)
+    {
+        // ensure the run flag is set before launching the thread
+        m_bRun = true;
+        m_bStarted = true;
+        m_pThread = std::make_unique<std::thread>([this]{Loop();});
+    }
+}
+
 void Manager::Stop()
 {
-    if(m_pThread)
+    std::unique_ptr<std::thread> pThread;
+    {
+        std::lock_guard<std::mutex> lg(m_mutexControl);
+        m_bStopped = true;
+        pThread = std::move(m_pThread);
+    }
+    //the thread takes m_mutexControl itself so it must not be held while joining
+    if(pThread)
     {
         m_bRun = false;
-        m_pThread->join();
-        m_pThread = nullptr;
+        pThread->join();
     }
 
 }
 
-void Manager::Flush(const std::stringstream& ssLog, Level level, const std::string& sPrefix)
+Manager::record& Manager::record::operator=(record&& other) noexcept
 {
-    m_qAction.try_enqueue(action(logEntry(ssLog.str(), level, sPrefix)));
+    nSequence = other.nSequence;
+    nTime = other.nTime;
+    nSlot = other.nSlot;
+    nLength = other.nLength;
+    nPrefix = other.nPrefix;
+    nPrefixLength = other.nPrefixLength;
+    eType = other.eType;
+    nLevel = other.nLevel;
+    nLogger = other.nLogger;
+    pHeap = std::move(other.pHeap);
+    pContext = std::move(other.pContext);
+    if(pHeap == nullptr)
+    {
+        //only copy the part of the inline buffer that is in use
+        auto nUsed = nSlot == detail::RecordPool::kNoSlot ? nPrefixLength+nLength : nPrefixLength;
+        std::memcpy(aInline, other.aInline, std::min(static_cast<size_t>(nUsed), kInline));
+    }
+    return *this;
+}
+
+bool Manager::IsEnabled(Level level, uint16_t nPrefix, uint16_t nLogger) const
+{
+    if(detail::IsAboveFloor(level) == false)
+    {
+        return false;
+    }
+    auto nPrefixLevel = nPrefix < Prefix::kMaxPrefixes ? m_aPrefixMinLevel[nPrefix].load(std::memory_order_relaxed) : 0;
+    auto nMinLevel = nPrefixLevel != 0 ? nPrefixLevel-1 : m_nMinLevel.load(std::memory_order_relaxed);
+    if(static_cast<int>(level) < nMinLevel || static_cast<int>(level) < m_aLoggerMinLevel[nLogger].load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+    if(m_aLoggerCheckOutputs[nLogger].load(std::memory_order_relaxed) == false)
+    {
+        return true;
+    }
+
+    //the logger routes to some of the outputs and one of them has prefix levels, so the min levels are only a bound. Ask the outputs themselves
+    auto pOutputs = std::atomic_load(&m_pOutputs);
+    for(const auto& route : pOutputs->vRoutes)
+    {
+        if(pOutputs->RoutesTo(nLogger, route) && route.Accepts(level, nPrefix))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Manager::Flush(detail::MessageBuffer& buffer, Level level, uint16_t nPrefix, const std::string& sPrefix, uint16_t nLogger)
+{
+    if(IsEnabled(level, nPrefix, nLogger) == false || buffer.IsDropped())
+    {
+        buffer.Clear();
+        return;
+    }
+
+    auto nShard = GetShard();
+    auto& aShard = *m_vShards[nShard];
+    record rec(record::Type::kEntry, level, nPrefix, aShard.nSequence.fetch_add(1, std::memory_order_relaxed));
+    rec.nTime = std::max(t_nLastTime, static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count()));
+    t_nLastTime = rec.nTime;
+    rec.nLength = static_cast<uint32_t>(buffer.GetLength());
+    rec.nLogger = nLogger;
+    rec.pContext = detail::ContextPtr(Context::Current());
+
+    if(buffer.GetPool())
+    {
+        //the message stays in the pool slot. An unregistered prefix goes in the inline buffer, cut short if need be
+        rec.nPrefixLength = static_cast<uint16_t>(std::min(sPrefix.size(), record::kInline));
+        std::memcpy(rec.aInline, sPrefix.data(), rec.nPrefixLength);
+        rec.nSlot = buffer.TakeSlot();
+    }
+    else if(sPrefix.empty() && rec.nLength > record::kInline)
+    {
+        rec.pHeap = buffer.TakeHeap();
+    }
+    else
+    {
+        rec.nPrefixLength = static_cast<uint16_t>(std::min(sPrefix.size(), size_t(0xFFFF)));
+        auto nTotal = rec.nPrefixLength+rec.nLength;
+        if(nTotal > record::kInline)
+        {
+            rec.pHeap.reset(new char[nTotal]);
+        }
+        auto pData = rec.pHeap ? rec.pHeap.get() : rec.aInline;
+        std::memcpy(pData, sPrefix.data(), rec.nPrefixLength);
+        std::memcpy(pData+rec.nPrefixLength, buffer.View().data(), rec.nLength);
+        buffer.Clear();
+    }
+
+    auto nSequence = rec.nSequence;
+    auto nSlot = rec.nSlot;
+    t_nLastSequence = nSequence+1;
+    t_bLastDropped = false;
+    if(aShard.qRecord.try_enqueue(std::move(rec)))
+    {
+        Wake();
+    }
+    else
+    {
+        t_bLastDropped = true;
+        if(nSlot != detail::RecordPool::kNoSlot)
+        {
+            m_pPool.load()->Release(nSlot);
+        }
+        //the entry will never reach the Manager thread so tell it to stop waiting for it
+        std::lock_guard<std::mutex> lg(m_mutexDropped);
+        m_vDropped.emplace_back(nShard, nSequence);
+        m_bDropped = true;
+    }
+}
+
+size_t Manager::GetShard()
+{
+    if(t_nShard == SIZE_MAX)
+    {
+        t_nShard = m_nNextShard.fetch_add(1, std::memory_order_relaxed) % m_vShards.size();
+    }
+    return t_nShard;
+}
+
+bool Manager::FlushAll(std::chrono::milliseconds timeout)
+{
+    //the barrier waits for the current sequence numbers rather than its place in the queue as it may overtake entries from other threads
+    std::vector<uint64_t> vTargets;
+    vTargets.reserve(m_vShards.size());
+    for(const auto& pShard : m_vShards)
+    {
+        vTargets.push_back(pShard->nSequence.load());
+    }
+    return WaitForSequence(std::move(vTargets), false, timeout);
+}
+
+bool Manager::WaitUntilDurable(std::chrono::milliseconds timeout)
+{
+    if(t_bLastDropped || t_nShard == SIZE_MAX)
+    {
+        return t_bLastDropped == false;
+    }
+    std::vector<uint64_t> vTargets(m_vShards.size(), 0);
+    vTargets[t_nShard] = t_nLastSequence;
+    return WaitForSequence(std::move(vTargets), true, timeout);
+}
+
+bool Manager::WaitForSequence(std::vector<uint64_t> vTargets, bool bDurable, std::chrono::milliseconds timeout)
+{
+    if(m_bStarted == false)
+    {
+        //nothing is queued until an output has been added and that starts the thread
+        return true;
+    }
+    if(m_bRun == false)
+    {
+        return false;
+    }
+
+    auto pPromise = std::make_shared<std::promise<bool>>();
+    auto future = pPromise->get_future();
+    {
+        std::lock_guard<std::mutex> lg(m_mutexBarriers);
+        m_vNewBarriers.push_back({std::move(vTargets), bDurable, std::move(pPromise)});
+        m_bNewBarriers = true;
+    }
+
+    //wake the Manager thread in case it is waiting for entries
+    if(m_vShards[0]->qRecord.enqueue(record(record::Type::kWake, Level::kTrace, 0, 0)) == false)
+    {
+        return false;
+    }
+    Wake();
+    return future.wait_for(timeout) == std::future_status::ready && future.get();
 }
 
 void Manager::Loop()
 {
+    m_bThreadConfigChanged = false;
+    DoApplyThreadConfig(GetThreadConfig(), "");
+
     while(m_bRun)
     {
-        HandleActionQueue();
+        HandleQueue();
     }
 
-    //allow any enqueued actions to be processed before exiting
+    //allow any enqueued records to be processed before exiting
     std::this_thread::sleep_for(std::chrono::milliseconds(200));
-    HandleActionQueue();
+    while(HandleQueue())
+    {
+    }
+    CheckBarriers(true);
+    m_pBatchOutputs = nullptr;
 
 }
 
-void Manager::HandleActionQueue()
+void Manager::Wake()
 {
-    action act;
-    while(m_qAction.wait_dequeue_timed(act, std::chrono::milliseconds(100)))
+    //pairs with the fence in Dequeue: either the Manager thread finds the record before it sleeps or this thread sees that it is sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(m_bSleeping.load(std::memory_order_relaxed))
     {
-        switch(act.eType)
+        m_semaphore.signal();
+    }
+}
+
+size_t Manager::TakeRecords()
+{
+    size_t nCount = 0;
+    for(size_t nShard = 0; nShard < m_vShards.size(); nShard++)
+    {
+        nCount += m_vShards[nShard]->qRecord.try_dequeue_bulk(m_vRecords.begin()+nCount, kBatchSize);
+        m_vShardEnd[nShard] = nCount;
+    }
+    return nCount;
+}
+
+size_t Manager::Dequeue()
+{
+    auto nCount = TakeRecords();
+    if(nCount != 0)
+    {
+        return nCount;
+    }
+
+    if(m_consumer == ConsumerMode::kBusyPoll)
+    {
+        for(size_t nSpin = 0; nSpin < kSpins; nSpin++)
         {
-            case action::Type::kAddOutput:
-                DoAddOutput(std::move(act.pLogout), act.nIndex);
-                break;
-            case action::Type::kSetOutputLevel:
-                DoSetOutputLevel(act.nIndex, act.level);
-                break;
-            case action::Type::kSetAllOutputLevel:
-                DoSetOutputLevel(act.level);
+            CpuRelax();
+            if((nCount = TakeRecords()) != 0)
+            {
+                return nCount;
+            }
+        }
+        //let anything else that wants the CPU have it until the idle period has passed
+        auto idleUntil = std::chrono::steady_clock::now()+m_busyPollIdle;
+        while(m_bRun && std::chrono::steady_clock::now() < idleUntil)
+        {
+            std::this_thread::yield();
+            if((nCount = TakeRecords()) != 0)
+            {
+                return nCount;
+            }
+        }
+    }
+
+    m_bSleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    nCount = TakeRecords();
+    if(nCount == 0 && m_semaphore.wait(std::chrono::duration_cast<std::chrono::microseconds>(kSleep).count()))
+    {
+        //several producers may have seen us sleeping. One wake up is enough
+        while(m_semaphore.tryWait())
+        {
+        }
+        nCount = TakeRecords();
+    }
+    m_bSleeping.store(false, std::memory_order_relaxed);
+    return nCount;
+}
+
+bool Manager::HandleQueue()
+{
+    auto nCount = Dequeue();
+    auto bRecords = (nCount != 0);
+
+    m_pBatchOutputs = std::atomic_load(&m_pOutputs);
+    if(bRecords)
+    {
+        //keep taking whatever has arrived, up to a limit, so that a single flush and commit of each output covers all of it
+        for(size_t nBatch = 1; nCount != 0; ++nBatch)
+        {
+            if(m_vShards.size() == 1)
+            {
+                for(size_t i = 0; i < nCount; i++)
+                {
+                    if(m_vRecords[i].eType == record::Type::kEntry)
+                    {
+                        LogRecord(m_vRecords[i]);
+                        Completed(*m_vShards[0], m_vRecords[i].nSequence);
+                    }
+                }
+            }
+            else
+            {
+                LogMerged(nCount);
+            }
+            nCount = nBatch < kMaxBatches ? TakeRecords() : 0;
+        }
+        MessagesDone();
+    }
+    CheckBarriers(false);
+
+    if(m_bThreadConfigChanged.exchange(false))
+    {
+        DoApplyThreadConfig(GetThreadConfig(), "");
+    }
+    return bRecords;
+}
+
+void Manager::LogMerged(size_t nCount)
+{
+    //each shard's records are in order for each thread and a thread's times never go backwards, so sorting by time, and then by where the record was taken, merges the shards
+    //without reordering any thread's messages. std::stable_sort would do the same but allocates each time.
+    //only this batch is sorted: a record that reaches its shard after the batch was taken goes out with the next one even if it is older
+    m_vOrder.resize(nCount);
+    std::iota(m_vOrder.begin(), m_vOrder.end(), 0);
+    std::sort(m_vOrder.begin(), m_vOrder.end(), [this](uint32_t a, uint32_t b){
+        return m_vRecords[a].nTime < m_vRecords[b].nTime || (m_vRecords[a].nTime == m_vRecords[b].nTime && a < b);
+    });
+    for(auto nRecord : m_vOrder)
+    {
+        if(m_vRecords[nRecord].eType == record::Type::kEntry)
+        {
+            LogRecord(m_vRecords[nRecord]);
+        }
+    }
+
+    size_t nRecord = 0;
+    for(size_t nShard = 0; nShard < m_vShards.size(); nShard++)
+    {
+        for(; nRecord < m_vShardEnd[nShard]; nRecord++)
+        {
+            if(m_vRecords[nRecord].eType == record::Type::kEntry)
+            {
+                Completed(*m_vShards[nShard], m_vRecords[nRecord].nSequence);
+            }
+        }
+    }
+}
+
+void Manager::Completed(shard& aShard, uint64_t nSequence)
+{
+    if(nSequence != aShard.nCompleted)
+    {
+        aShard.pqCompleted.push(nSequence);
+        return;
+    }
+
+    ++aShard.nCompleted;
+    while(aShard.pqCompleted.empty() == false && aShard.pqCompleted.top() == aShard.nCompleted)
+    {
+        aShard.pqCompleted.pop();
+        ++aShard.nCompleted;
+    }
+}
+
+void Manager::CollectDropped()
+{
+    std::vector<std::pair<size_t, uint64_t>> vDropped;
+    {
+        std::lock_guard<std::mutex> lg(m_mutexDropped);
+        vDropped.swap(m_vDropped);
+        m_bDropped = false;
+    }
+    for(const auto& dropped : vDropped)
+    {
+        Completed(*m_vShards[dropped.first], dropped.second);
+    }
+}
+
+void Manager::CheckBarriers(bool bFinal)
+{
+    if(m_bNewBarriers)
+    {
+        std::lock_guard<std::mutex> lg(m_mutexBarriers);
+        std::move(m_vNewBarriers.begin(), m_vNewBarriers.end(), std::back_inserter(m_vBarriers));
+        m_vNewBarriers.clear();
+        m_bNewBarriers = false;
+    }
+
+    if(m_vBarriers.empty())
+    {
+        return;
+    }
+
+    if(m_bDropped)
+    {
+        CollectDropped();
+    }
+
+    auto itEnd = std::partition(m_vBarriers.begin(), m_vBarriers.end(), [this](const barrier& b){
+        for(size_t i = 0; i < m_vShards.size(); i++)
+        {
+            if(b.vTargets[i] > m_vShards[i]->nCompleted)
+            {
+                return true;
+            }
+        }
+        return false;
+    });
+    if(itEnd != m_vBarriers.end())
+    {
+        MessagesDone();
+        for(auto it = itEnd; it != m_vBarriers.end(); ++it)
+        {
+            it->pPromise->set_value(it->bDurable == false || IsCommitted(*it));
+        }
+        m_vBarriers.erase(itEnd, m_vBarriers.end());
+    }
+
+    if(bFinal)
+    {
+        //the thread is exiting so these can never be met
+        for(auto& aBarrier : m_vBarriers)
+        {
+            aBarrier.pPromise->set_value(false);
+        }
+        m_vBarriers.clear();
+    }
+}
+
+void Manager::LogRecord(const record& rec)
+{
+    auto pPool = m_pPool.load(std::memory_order_relaxed);
+    auto pData = rec.GetData();
+
+    //m_sMessage and m_sPrefix keep their capacity so these do not allocate once they have grown
+    if(rec.nSlot != detail::RecordPool::kNoSlot)
+    {
+        m_sMessage.assign(pPool->GetData(rec.nSlot), rec.nLength);
+    }
+    else
+    {
+        m_sMessage.assign(pData+rec.nPrefixLength, rec.nLength);
+    }
+
+    const std::string* pPrefix = &m_sPrefix;
+    if(rec.nPrefix == Prefix::kUnregistered)
+    {
+        m_sPrefix.assign(pData, rec.nPrefixLength);
+    }
+    else
+    {
+        pPrefix = &PrefixRegistry::Get().GetName(rec.nPrefix);
+    }
+
+    auto level = static_cast<Level>(rec.nLevel);
+    auto tp = rec.nTime != 0 ? std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(rec.nTime)))
+                             : std::chrono::system_clock::now();
+    m_renderer.Start(tp, level, *pPrefix, m_sMessage, rec.pContext.get());
+
+    for(const auto& route : m_pBatchOutputs->vRoutes)
+    {
+        if(m_pBatchOutputs->RoutesTo(rec.nLogger, route) && route.Accepts(level, rec.nPrefix))
+        {
+            route.pOutput->OutputMessage(level, m_sMessage, *pPrefix, rec.pContext.get(), &m_renderer);
+        }
+    }
+
+    if(rec.nSlot != detail::RecordPool::kNoSlot)
+    {
+        pPool->Release(rec.nSlot);
+    }
+}
+
+namespace detail
+{
+void Renderer::Start(std::chrono::system_clock::time_point tp, Level level, const std::string& sPrefix, const std::string& sLog, const Context* pContext)
+{
+    m_tp = tp;
+    m_level = level;
+    m_pPrefix = &sPrefix;
+    m_pLog = &sLog;
+    m_pContext = pContext;
+    ++m_nMessage;
+}
+
+const std::string& Renderer::GetLine(int nTimestamp, Output::TS resolution)
+{
+    auto itFormat = std::find_if(m_vFormats.begin(), m_vFormats.end(), [nTimestamp, resolution](const format& aFormat){
+        return aFormat.nTimestamp == nTimestamp && aFormat.resolution == resolution;
+    });
+    if(itFormat == m_vFormats.end())
+    {
+        itFormat = m_vFormats.insert(m_vFormats.end(), format{nTimestamp, resolution, 0, std::string()});
+    }
+    if(itFormat->nMessage != m_nMessage)
+    {
+        Render(*itFormat);
+        itFormat->nMessage = m_nMessage;
+    }
+    return itFormat->sLine;
+}
+
+void Renderer::Render(format& aFormat)
+{
+    auto& sLine = aFormat.sLine;
+    sLine.clear();
+    if(aFormat.nTimestamp != Output::kTsNone)
+    {
+        auto nSecond = std::chrono::system_clock::to_time_t(m_tp);
+        if(nSecond != m_nLocalSecond)
+        {
+            localtime_r(&nSecond, &m_tmLocal);
+            m_nLocalSecond = nSecond;
+        }
+
+        char sTime[48];
+        size_t nLength = 0;
+        if((aFormat.nTimestamp & Output::kTsDate))
+        {
+            nLength += strftime(sTime+nLength, sizeof(sTime)-nLength, "%Y-%m-%d ", &m_tmLocal);
+        }
+        if((aFormat.nTimestamp & Output::kTsTime))
+        {
+            nLength += strftime(sTime+nLength, sizeof(sTime)-nLength, "%H:%M:%S", &m_tmLocal);
+        }
+        auto sinceEpoch = m_tp.time_since_epoch();
+        switch(aFormat.resolution)
+        {
+            case Output::TS::kMillisecond:
+                nLength += snprintf(sTime+nLength, sizeof(sTime)-nLength, ".%03d", static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(sinceEpoch).count()%1000));
                 break;
-            case action::Type::kRemoveOutput:
-                DoRemoveOutput(act.nIndex);
+            case Output::TS::kMicrosecond:
+                nLength += snprintf(sTime+nLength, sizeof(sTime)-nLength, ".%06d", static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(sinceEpoch).count()%1000000));
                 break;
-            case action::Type::kEntry:
-                LogAction(act.entry);
+            case Output::TS::kNanosecond:
+                nLength += snprintf(sTime+nLength, sizeof(sTime)-nLength, ".%09d", static_cast<int>(std::chrono::duration_cast<std::chrono::nanoseconds>(sinceEpoch).count()%1000000000));
                 break;
             default:
                 break;
         }
+        sLine.append(sTime, nLength);
+        sLine += '\t';
+    }
+    sLine += Stream::STR_LEVEL[static_cast<int>(m_level)];
+    sLine += "\t[";
+    sLine += *m_pPrefix;
+    sLine += "]\t";
+    if(m_pContext)
+    {
+        sLine += "{";
+        sLine += m_pContext->GetText();
+        sLine += "}\t";
+    }
+    sLine += *m_pLog;
+}
+}
+
+bool Manager::UseRecordPool(uint32_t nSlots, size_t nCapacity)
+{
+    std::lock_guard<std::mutex> lg(m_mutexControl);
+    if(m_pPoolOwner)
+    {
+        return false;
     }
+    m_pPoolOwner = std::make_unique<detail::RecordPool>(nSlots, nCapacity);
+    m_sMessage.reserve(nCapacity);
+    m_pPool = m_pPoolOwner.get();
+    return true;
 }
 
-void Manager::LogAction(const logEntry& entry)
+void Manager::MessagesDone()
 {
-    if(m_mOutput.empty()) return;
+    bool bCommitted = true;
+    for(auto& pairOutput : m_pBatchOutputs->mOutputs)
+    {
+        bCommitted &= pairOutput.second->MessagesDone();
+    }
 
-    for(auto& pairOutput : m_mOutput)
+    for(auto& pShard : m_vShards)
     {
-        pairOutput.second->OutputMessage(entry.level, entry.sLog, entry.sPrefix);
+        if(bCommitted == false)
+        {
+            //everything output since the last commit was in the batch that failed
+            pShard->nFailedFrom = pShard->nCommitted;
+            pShard->nFailedTo = pShard->nCompleted;
+        }
+        pShard->nCommitted = pShard->nCompleted;
     }
-    
-    for(auto& pairOutput : m_mOutput)
+}
+
+bool Manager::IsCommitted(const barrier& aBarrier) const
+{
+    //a target is one more than the last entry waited for
+    for(size_t i = 0; i < m_vShards.size(); i++)
     {
-        pairOutput.second->MessagesDone();
+        if(aBarrier.vTargets[i] > m_vShards[i]->nFailedFrom && aBarrier.vTargets[i] <= m_vShards[i]->nFailedTo)
+        {
+            return false;
+        }
     }
+    return true;
 }
 
-void Manager::SetOutputLevel(size_t nIndex, Level level)
+void Manager::Publish(std::shared_ptr<outputSet> pOutputs)
 {
-    m_qAction.try_enqueue(action(action::Type::kSetOutputLevel, nIndex, level, nullptr));
+    CalculateRoutes(*pOutputs);
+    auto levels = CalculateMinLevel(*pOutputs);
+
+    //until the new set is published producers check the lower of its levels and the old set's, so that they never drop a message that the set in use would accept
+    auto lowest = CalculateMinLevel(*std::atomic_load(&m_pOutputs));
+    lowest.Lower(levels);
+    StoreMinLevel(lowest);
+    std::atomic_store(&m_pOutputs, std::shared_ptr<const outputSet>(std::move(pOutputs)));
+    StoreMinLevel(levels);
 }
 
-void Manager::DoSetOutputLevel(size_t nIndex, Level level)
+void Manager::RepublishRoutes()
 {
-    auto itOutput = m_mOutput.find(nIndex);
-    if(itOutput != m_mOutput.end())
+    Publish(std::make_shared<outputSet>(*std::atomic_load(&m_pOutputs)));
+}
+
+void Manager::CalculateRoutes(outputSet& outputs) const
+{
+    outputs.vRoutes.clear();
+    outputs.nWords = (outputs.mOutputs.size()+63)/64;
+    outputs.vMasks.assign(m_vLoggers.size()*outputs.nWords, 0);
+
+    auto nCount = PrefixRegistry::Get().GetCount();
+    size_t nIndex = 0;
+    for(const auto& pairOutput : outputs.mOutputs)
+    {
+        outputSet::route aRoute{nIndex/64, uint64_t(1) << (nIndex%64), pairOutput.second.get(), pairOutput.second->GetOutputLevel(), {}};
+        //copy the levels so that every message in a batch is checked against the same ones
+        for(uint16_t nPrefix = 0; nPrefix < nCount; nPrefix++)
+        {
+            if(auto nLevel = pairOutput.second->GetPrefixLevel(nPrefix); nLevel != 0)
+            {
+                aRoute.vPrefixLevels.resize(nPrefix+1, 0);
+                aRoute.vPrefixLevels[nPrefix] = static_cast<int8_t>(nLevel);
+            }
+        }
+        for(size_t nLogger = 0; nLogger < m_vLoggers.size(); nLogger++)
+        {
+            if(m_vLoggers[nLogger].RoutesTo(pairOutput.first))
+            {
+                outputs.vMasks[nLogger*outputs.nWords+aRoute.nWord] |= aRoute.nBit;
+            }
+        }
+        outputs.vRoutes.push_back(std::move(aRoute));
+        ++nIndex;
+    }
+}
+
+Manager::minLevels Manager::CalculateMinLevel(const outputSet& outputs) const
+{
+    minLevels levels;
+    std::vector<int> vOutputFloor;      ///< the lowest level each output accepts for any prefix, in vRoutes order
+    vOutputFloor.reserve(outputs.vRoutes.size());
+    for(const auto& route : outputs.vRoutes)
+    {
+        levels.nMin = std::min(levels.nMin, static_cast<int>(route.level));
+        vOutputFloor.push_back(static_cast<int>(route.level));
+    }
+
+    //only prefixes that have a level set on at least one output get an entry
+    levels.nFloor = levels.nMin;
+    levels.vPrefix.assign(PrefixRegistry::Get().GetCount(), 0);
+    for(uint16_t nPrefix = 0; nPrefix < levels.vPrefix.size(); nPrefix++)
+    {
+        auto bSet = false;
+        auto nPrefixMin = kNoOutputs;
+        size_t nIndex = 0;
+        for(const auto& route : outputs.vRoutes)
+        {
+            int nLevel = nPrefix < route.vPrefixLevels.size() ? route.vPrefixLevels[nPrefix] : 0;
+            bSet |= (nLevel != 0);
+            nPrefixMin = std::min(nPrefixMin, nLevel != 0 ? nLevel-1 : static_cast<int>(route.level));
+            if(nLevel != 0)
+            {
+                vOutputFloor[nIndex] = std::min(vOutputFloor[nIndex], nLevel-1);
+            }
+            ++nIndex;
+        }
+        levels.vPrefix[nPrefix] = static_cast<int8_t>(bSet ? nPrefixMin+1 : 0);
+        levels.nFloor = std::min(levels.nFloor, nPrefixMin);
+    }
+
+    //a logger's message can only be output if both the logger and at least one of the outputs it routes to accept its level
+    levels.vLogger.resize(m_vLoggers.size());
+    levels.vCheckOutputs.resize(m_vLoggers.size());
+    for(size_t nLogger = 0; nLogger < m_vLoggers.size(); nLogger++)
+    {
+        auto nLoggerMin = kNoOutputs;
+        auto bAll = true;
+        auto bPrefixLevels = false;
+        size_t nIndex = 0;
+        for(const auto& route : outputs.vRoutes)
+        {
+            if(outputs.RoutesTo(nLogger, route))
+            {
+                nLoggerMin = std::min(nLoggerMin, vOutputFloor[nIndex]);
+                bPrefixLevels |= (route.vPrefixLevels.empty() == false);
+            }
+            else
+            {
+                bAll = false;
+            }
+            ++nIndex;
+        }
+        levels.vLogger[nLogger] = static_cast<int8_t>(std::max(nLoggerMin, static_cast<int>(m_vLoggers[nLogger].level)));
+        //the prefix and logger min levels together are exact unless the prefix levels belong to outputs the logger does not route to
+        levels.vCheckOutputs[nLogger] = !bAll && bPrefixLevels;
+    }
+    return levels;
+}
+
+void Manager::minLevels::Lower(const minLevels& other)
+{
+    vPrefix.resize(std::max(vPrefix.size(), other.vPrefix.size()), 0);
+    for(size_t nPrefix = 0; nPrefix < vPrefix.size(); nPrefix++)
+    {
+        int nLevel = vPrefix[nPrefix];
+        int nOther = nPrefix < other.vPrefix.size() ? other.vPrefix[nPrefix] : 0;
+        if(nLevel != 0 || nOther != 0)
+        {
+            vPrefix[nPrefix] = static_cast<int8_t>(std::min(nLevel != 0 ? nLevel-1 : nMin, nOther != 0 ? nOther-1 : other.nMin)+1);
+        }
+    }
+    nMin = std::min(nMin, other.nMin);
+    nFloor = std::min(nFloor, other.nFloor);
+    for(size_t nLogger = 0; nLogger < vLogger.size() && nLogger < other.vLogger.size(); nLogger++)
+    {
+        vLogger[nLogger] = std::min(vLogger[nLogger], other.vLogger[nLogger]);
+        vCheckOutputs[nLogger] = vCheckOutputs[nLogger] || other.vCheckOutputs[nLogger];
+    }
+}
+
+void Manager::StoreMinLevel(const minLevels& levels)
+{
+    m_nMinLevel = levels.nMin;
+    for(size_t nPrefix = 0; nPrefix < levels.vPrefix.size(); nPrefix++)
+    {
+        m_aPrefixMinLevel[nPrefix] = levels.vPrefix[nPrefix];
+    }
+    detail::g_nFloorLevel = levels.nFloor;
+    for(size_t nLogger = 0; nLogger < levels.vLogger.size(); nLogger++)
+    {
+        m_aLoggerMinLevel[nLogger] = levels.vLogger[nLogger];
+        m_aLoggerCheckOutputs[nLogger] = levels.vCheckOutputs[nLogger];
+    }
+}
+
+std::optional<uint16_t> Manager::RegisterLogger(const std::string& sName)
+{
+    if(sName.empty())
+    {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lg(m_mutexControl);
+    if(auto itId = m_mLoggerIds.find(sName); itId != m_mLoggerIds.end())
+    {
+        return itId->second;
+    }
+    if(m_vLoggers.size() >= Logger::kMaxLoggers)
+    {
+        std::cout << "Could not register logger " << sName << "\tall " << Logger::kMaxLoggers << " loggers are in use so its messages go through the default logger" << std::endl;
+        return std::nullopt;
+    }
+
+    auto nId = static_cast<uint16_t>(m_vLoggers.size());
+    m_vLoggers.emplace_back();
+    m_mLoggerIds.insert(std::make_pair(sName, nId));
+    StoreMinLevel(CalculateMinLevel(*std::atomic_load(&m_pOutputs)));
+    return nId;
+}
+
+void Manager::SetLoggerLevel(uint16_t nLogger, Level level)
+{
+    std::lock_guard<std::mutex> lg(m_mutexControl);
+    m_vLoggers[nLogger].level = level;
+    StoreMinLevel(CalculateMinLevel(*std::atomic_load(&m_pOutputs)));
+}
+
+void Manager::SetLoggerRoutes(uint16_t nLogger, std::optional<std::set<size_t>> routes)
+{
+    std::lock_guard<std::mutex> lg(m_mutexControl);
+    m_vLoggers[nLogger].routes = std::move(routes);
+    RepublishRoutes();
+}
+
+void Manager::AddLoggerRoute(uint16_t nLogger, size_t nOutput, bool bAdd)
+{
+    std::lock_guard<std::mutex> lg(m_mutexControl);
+    auto& routes = m_vLoggers[nLogger].routes;
+    if(bAdd && routes)
+    {
+        routes->insert(nOutput);
+    }
+    else if(bAdd == false)
+    {
+        if(!routes)
+        {
+            //routing to everything so start from the outputs there are now
+            routes.emplace();
+            for(const auto& pairOutput : std::atomic_load(&m_pOutputs)->mOutputs)
+            {
+                routes->insert(pairOutput.first);
+            }
+        }
+        routes->erase(nOutput);
+    }
+    RepublishRoutes();
+}
+
+void Manager::SetOutputLevel(size_t nIndex, Level level)
+{
+    std::lock_guard<std::mutex> lg(m_mutexControl);
+    auto pOutputs = std::make_shared<outputSet>(*std::atomic_load(&m_pOutputs));
+
+    auto itOutput = pOutputs->mOutputs.find(nIndex);
+    if(itOutput != pOutputs->mOutputs.end())
     {
         itOutput->second->SetOutputLevel(level);
+        Publish(std::move(pOutputs));
     }
 }
 
-void Manager::SetOutputLevel(Level level)
+void Manager::SetDurability(size_t nIndex, Level level, Durability durability)
 {
-    m_qAction.try_enqueue(action(action::Type::kSetAllOutputLevel, 0, level, nullptr));
+    std::lock_guard<std::mutex> lg(m_mutexControl);
+    auto pOutputs = std::atomic_load(&m_pOutputs);
+
+    auto itOutput = pOutputs->mOutputs.find(nIndex);
+    if(itOutput != pOutputs->mOutputs.end())
+    {
+        itOutput->second->SetDurability(level, durability);
+    }
 }
 
-void Manager::DoSetOutputLevel(Level level)
+void Manager::SetOutputLevel(Level level)
 {
-    for(auto& pairOutput : m_mOutput)
+    std::lock_guard<std::mutex> lg(m_mutexControl);
+    auto pOutputs = std::make_shared<outputSet>(*std::atomic_load(&m_pOutputs));
+
+    for(auto& pairOutput : pOutputs->mOutputs)
     {
         pairOutput.second->SetOutputLevel(level);
     }
+    Publish(std::move(pOutputs));
 }
 
-size_t Manager::AddOutput(std::unique_ptr<Output> pLogout)
+void Manager::SetOutputLevel(size_t nIndex, const Prefix& prefix, Level level)
 {
-    m_nOutputIdGenerator++;
-    m_qAction.try_enqueue(action(action::Type::kAddOutput, m_nOutputIdGenerator, Level::kInfo, std::move(pLogout)));
-    return m_nOutputIdGenerator;
+    std::lock_guard<std::mutex> lg(m_mutexControl);
+    auto pOutputs = std::make_shared<outputSet>(*std::atomic_load(&m_pOutputs));
+
+    auto itOutput = pOutputs->mOutputs.find(nIndex);
+    if(itOutput != pOutputs->mOutputs.end())
+    {
+        itOutput->second->SetPrefixLevel(prefix, level);
+        Publish(std::move(pOutputs));
+    }
 }
 
+void Manager::SetOutputLevel(const Prefix& prefix, Level level)
+{
+    std::lock_guard<std::mutex> lg(m_mutexControl);
+    auto pOutputs = std::make_shared<outputSet>(*std::atomic_load(&m_pOutputs));
+
+    for(auto& pairOutput : pOutputs->mOutputs)
+    {
+        pairOutput.second->SetPrefixLevel(prefix, level);
+    }
+    Publish(std::move(pOutputs));
+}
 
-void Manager::DoAddOutput(std::unique_ptr<Output> pLogout, size_t nId)
+size_t Manager::AddOutput(std::unique_ptr<Output> pLogout)
 {
-    m_mOutput.insert(std::make_pair(nId, move(pLogout)));
+    std::lock_guard<std::mutex> lg(m_mutexControl);
+    auto pOutputs = std::make_shared<outputSet>(*std::atomic_load(&m_pOutputs));
+
+    ++m_nOutputIdGenerator;
+    pOutputs->mOutputs.insert(std::make_pair(m_nOutputIdGenerator, std::shared_ptr<Output>(std::move(pLogout))));
+    Publish(std::move(pOutputs));
+    StartThread();
+
+    return m_nOutputIdGenerator;
 }
 
 void Manager::RemoveOutput(size_t nIndex)
 {
-    m_qAction.try_enqueue(action(action::Type::kRemoveOutput, nIndex, Level::kInfo, nullptr));
+    std::lock_guard<std::mutex> lg(m_mutexControl);
+    auto pOutputs = std::make_shared<outputSet>(*std::atomic_load(&m_pOutputs));
+
+    if(pOutputs->mOutputs.erase(nIndex) != 0)
+    {
+        Publish(std::move(pOutputs));
+    }
 }
 
-void Manager::DoRemoveOutput(size_t nIndex)
+/******* Output ********/
+
+void Output::DoOutputMessage(Level, const std::string&, const std::string&)
 {
-    m_mOutput.erase(nIndex);
+    std::cout << GetLine();
 }
 
-/******* Output ********/
+void Output::WriteContext(std::ostream& os) const
+{
+    if(m_pContext)
+    {
+        os << "{" << m_pContext->GetText() << "}\t";
+    }
+}
 
-void Output::DoOutputMessage(Level level, const std::string&  sLog, const std::string& sPrefix)
+void Output::WriteContext(std::string& sLine) const
 {
-    if(level >= m_level)
+    if(m_pContext)
     {
-        std::cout << Timestamp().str();
-        std::cout << Stream::STR_LEVEL[static_cast<int>(level)] << "\t" << "[" << sPrefix << "]\t" << sLog;
+        sLine += "{";
+        sLine += m_pContext->GetText();
+        sLine += "}\t";
     }
 }
 
+const std::string& Output::GetLine() const
+{
+    return m_pRenderer->GetLine(m_nTimestamp, m_resolution);
+}
+
+std::chrono::system_clock::time_point Output::GetTime() const
+{
+    return m_pRenderer->GetTime();
+}
+
 void Output::Flush()
 {
     std::cout << std::flush;
@@ -257,51 +1190,157 @@ Level Output::GetOutputLevel() const
     return m_level;
 }
 
+void Output::SetPrefixLevel(const Prefix& prefix, Level level)
+{
+    if(prefix.GetId() < Prefix::kMaxPrefixes)
+    {
+        m_pPrefixLevels[prefix.GetId()] = static_cast<int8_t>(static_cast<int>(level)+1);
+    }
+}
+
+void Output::ClearPrefixLevel(const Prefix& prefix)
+{
+    if(prefix.GetId() < Prefix::kMaxPrefixes)
+    {
+        m_pPrefixLevels[prefix.GetId()] = 0;
+    }
+}
+
+Level Output::GetOutputLevel(const Prefix& prefix) const
+{
+    auto nLevel = prefix.GetId() < Prefix::kMaxPrefixes ? GetPrefixLevel(prefix.GetId()) : 0;
+    return nLevel != 0 ? static_cast<Level>(nLevel-1) : GetOutputLevel();
+}
+
+void Output::SetDurability(Durability durability)
+{
+    for(auto& aDurability : m_aDurability)
+    {
+        aDurability = durability;
+    }
+}
+
+void Output::SetDurability(Level level, Durability durability)
+{
+    m_aDurability[static_cast<int>(level)] = durability;
+}
+
+Durability Output::GetDurability(Level level) const
+{
+    return m_aDurability[static_cast<int>(level)];
+}
+
+bool Output::Commit(Durability)
+{
+    return true;
+}
+
 
 /************* Stream ********************/
 
 
-Stream::Stream(pml::enumLevel eLevel, const std::string& sPrefix) : m_level(static_cast<Level>(eLevel)), m_sPrefix(sPrefix)
+Stream::Stream(pml::enumLevel eLevel, const std::string& sPrefix) : Stream(static_cast<Level>(eLevel), sPrefix)
 {
 }
 
-Stream::Stream(Level level, const std::string& sPrefix) : m_level(level), m_sPrefix(sPrefix)
+Stream::Stream(Level level, const std::string& sPrefix) : m_buffer(Manager::Get().GetRecordPool()), m_stream(&m_buffer), m_level(level), m_nPrefix(PrefixRegistry::Get().Intern(sPrefix))
 {
+    if(m_nPrefix == Prefix::kUnregistered)
+    {
+        m_sPrefix = sPrefix;
+    }
+}
 
+Stream::Stream(Level level, const Logger& logger) : Stream(level, logger.m_prefix)
+{
+    m_nLogger = logger.GetId();
+}
+
+Stream::Stream(Level level, const Prefix& prefix) : m_buffer(Manager::Get().GetRecordPool()), m_stream(&m_buffer), m_level(level), m_nPrefix(prefix.GetId())
+{
+    if(m_nPrefix == Prefix::kUnregistered)
+    {
+        m_sPrefix = prefix.GetName();
+    }
 }
 
 Stream::~Stream()
 {
-    m_stream << "\n";
-    flush();
+    //a message ended with std::endl or std::flush has already been flushed, so only flush if there is something new
+    if(m_bActive && (m_buffer.GetLength() != 0 || m_buffer.IsDropped()))
+    {
+        m_stream << "\n";
+        flush();
+    }
 }
 
-Stream::Stream(const Stream& lg) : m_level(lg.GetLevel()), m_sPrefix(lg.GetPrefix())
+Stream::Stream(Stream&& other) noexcept : m_buffer(std::move(other.m_buffer)), m_stream(&m_buffer), m_level(other.m_level), m_nPrefix(other.m_nPrefix), m_nLogger(other.m_nLogger), m_sPrefix(std::move(other.m_sPrefix)),
+m_bActive(other.m_bActive)
 {
-    m_stream << lg.GetStream().str();
+    m_stream.copyfmt(other.m_stream);
+    m_stream.clear(other.m_stream.rdstate());
+    other.m_bActive = false;
 }
 
 
-Stream& Stream::operator=(const Stream& lg)
+Stream& Stream::operator=(Stream&& other) noexcept
 {
-    if(&lg != this)
+    if(&other != this)
     {
-        m_stream.str(std::string());
-        m_stream.clear();
-
-        m_stream << lg.GetStream().str();
-        m_level = lg.GetLevel();
-        m_sPrefix = lg.GetPrefix();
+        if(m_bActive && (m_buffer.GetLength() != 0 || m_buffer.IsDropped()))
+        {
+            m_stream << "\n";
+            flush();
+        }
+        m_buffer = std::move(other.m_buffer);
+        m_stream.copyfmt(other.m_stream);
+        m_stream.clear(other.m_stream.rdstate());
+        m_level = other.m_level;
+        m_nPrefix = other.m_nPrefix;
+        m_nLogger = other.m_nLogger;
+        m_sPrefix = std::move(other.m_sPrefix);
+        m_bActive = other.m_bActive;
+        other.m_bActive = false;
     }
     return *this;
 }
 
 
+const std::string& Stream::GetPrefix() const
+{
+    return m_nPrefix == Prefix::kUnregistered ? m_sPrefix : PrefixRegistry::Get().GetName(m_nPrefix);
+}
+
+bool Stream::IsEnabled() const
+{
+    return m_bActive && Manager::Get().IsEnabled(m_level, m_nPrefix, m_nLogger);
+}
+
+bool Stream::IsEnabled(Level level, const std::string& sPrefix)
+{
+    //check the floor before interning the prefix so that a disabled level costs a single load
+    return detail::IsAboveFloor(level) && Manager::Get().IsEnabled(level, PrefixRegistry::Get().Intern(sPrefix));
+}
+
+bool Stream::IsEnabled(Level level, const Prefix& prefix)
+{
+    return Manager::Get().IsEnabled(level, prefix.GetId());
+}
+
+bool Stream::IsEnabled(Level level, const Logger& logger)
+{
+    return Manager::Get().IsEnabled(level, logger.m_prefix.GetId(), logger.GetId());
+}
+
 void Stream::flush()
 {
-    Manager::Get().Flush(m_stream, m_level, m_sPrefix);
+    if(m_bActive == false)
+    {
+        m_buffer.Clear();
+        return;
+    }
+    Manager::Get().Flush(m_buffer, m_level, m_nPrefix, m_sPrefix, m_nLogger);
 
-    m_stream.str(std::string());
     m_stream.clear();
 }
 
@@ -325,6 +1364,16 @@ void Stream::SetOutputLevel(Level level)
     Manager::Get().SetOutputLevel(level);
 }
 
+void Stream::SetOutputLevel(size_t nIndex, const Prefix& prefix, Level level)
+{
+    Manager::Get().SetOutputLevel(nIndex, prefix, level);
+}
+
+void Stream::SetOutputLevel(const Prefix& prefix, Level level)
+{
+    Manager::Get().SetOutputLevel(prefix, level);
+}
+
 size_t Stream::AddOutput(std::unique_ptr<Output> pLogout)
 {
     return Manager::Get().AddOutput(std::move(pLogout));
@@ -370,4 +1419,29 @@ void Stream::Stop()
 {
     Manager::Get().Stop();
 }
+
+bool Stream::UseRecordPool(uint32_t nSlots, size_t nCapacity)
+{
+    return Manager::Get().UseRecordPool(nSlots, nCapacity);
+}
+
+bool Stream::FlushAll(std::chrono::milliseconds timeout)
+{
+    return Manager::Get().FlushAll(timeout);
+}
+
+void Stream::SetDurability(size_t nIndex, Level level, Durability durability)
+{
+    Manager::Get().SetDurability(nIndex, level, durability);
+}
+
+bool Stream::WaitUntilDurable(std::chrono::milliseconds timeout)
+{
+    return Manager::Get().WaitUntilDurable(timeout);
+}
+
+void Stream::SetThreadConfig(const ThreadConfig& config)
+{
+    Manager::Get().SetThreadConfig(config);
+}
 }
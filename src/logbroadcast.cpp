@@ -0,0 +1,177 @@
+#include "logbroadcast.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string_view>
+
+namespace pml::log
+{
+namespace detail
+{
+    /** @brief single writer, multiple reader ring. Each slot is protected by its own sequence number (a seqlock): it is odd while the Manager thread is writing to the slot and
+    *   2*(n+1) once message n is in the slot. A reader copies the slot and then checks the sequence number has not changed, so a reader never blocks the writer.
+    **/
+    class BroadcastRing
+    {
+        public:
+            static constexpr size_t kSlotSize = 256;
+
+            struct alignas(64) slot
+            {
+                std::atomic<uint64_t> nSequence{0};
+                int64_t nTime = 0;
+                uint32_t nLength = 0;
+                uint16_t nPrefixLength = 0;
+                uint16_t nContextLength = 0;
+                uint8_t nLevel = 0;
+                bool bTruncated = false;
+                char aData[kSlotSize-26];     ///< the prefix, then the context and then the message
+            };
+            static_assert(sizeof(slot) == kSlotSize);
+
+            explicit BroadcastRing(size_t nSlots) : m_nMask(nSlots-1), m_pSlots(new slot[nSlots]){}
+
+            void Write(std::chrono::system_clock::time_point tp, Level level, std::string_view sLog, std::string_view sPrefix, std::string_view sContext);
+            bool Read(uint64_t& nCursor, uint64_t& nOverrun, Broadcast::Record& rec) const;
+
+            uint64_t GetHead() const { return m_nHead.load(std::memory_order_acquire); }
+            uint64_t GetOldest() const
+            {
+                auto nHead = GetHead();
+                //leave one slot spare as the writer may already be overwriting the oldest one
+                return nHead > m_nMask ? nHead-m_nMask : 0;
+            }
+
+        private:
+            const uint64_t m_nMask;
+            std::unique_ptr<slot[]> m_pSlots;
+            alignas(64) std::atomic<uint64_t> m_nHead{0};   ///< the number of messages written
+    };
+
+    void BroadcastRing::Write(std::chrono::system_clock::time_point tp, Level level, std::string_view sLog, std::string_view sPrefix, std::string_view sContext)
+    {
+        auto nMessage = m_nHead.load(std::memory_order_relaxed);
+        auto& aSlot = m_pSlots[nMessage & m_nMask];
+
+        aSlot.nSequence.store(2*nMessage+1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        aSlot.nTime = std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+        aSlot.nLevel = static_cast<uint8_t>(level);
+        aSlot.nPrefixLength = static_cast<uint16_t>(std::min(sPrefix.size(), sizeof(aSlot.aData)));
+        aSlot.nContextLength = static_cast<uint16_t>(std::min(sContext.size(), sizeof(aSlot.aData)-aSlot.nPrefixLength));
+        auto nHeader = aSlot.nPrefixLength+aSlot.nContextLength;
+        aSlot.nLength = static_cast<uint32_t>(std::min(sLog.size(), sizeof(aSlot.aData)-nHeader));
+        aSlot.bTruncated = aSlot.nLength < sLog.size() || aSlot.nContextLength < sContext.size();
+        std::memcpy(aSlot.aData, sPrefix.data(), aSlot.nPrefixLength);
+        std::memcpy(aSlot.aData+aSlot.nPrefixLength, sContext.data(), aSlot.nContextLength);
+        std::memcpy(aSlot.aData+nHeader, sLog.data(), aSlot.nLength);
+
+        aSlot.nSequence.store(2*nMessage+2, std::memory_order_release);
+        m_nHead.store(nMessage+1, std::memory_order_release);
+    }
+
+    bool BroadcastRing::Read(uint64_t& nCursor, uint64_t& nOverrun, Broadcast::Record& rec) const
+    {
+        while(true)
+        {
+            auto nHead = GetHead();
+            if(nCursor >= nHead)
+            {
+                return false;
+            }
+            if(nHead-nCursor > m_nMask)
+            {
+                auto nOldest = GetOldest();
+                nOverrun += nOldest-nCursor;
+                nCursor = nOldest;
+            }
+
+            const auto& aSlot = m_pSlots[nCursor & m_nMask];
+            auto nSequence = aSlot.nSequence.load(std::memory_order_acquire);
+            if(nSequence == 2*nCursor+2)
+            {
+                auto nTime = aSlot.nTime;
+                auto nLevel = aSlot.nLevel;
+                auto bTruncated = aSlot.bTruncated;
+                //the lengths may be torn if the writer has lapped us, so keep them inside the slot until the sequence number is checked
+                auto nPrefixLength = std::min<size_t>(aSlot.nPrefixLength, sizeof(aSlot.aData));
+                auto nContextLength = std::min<size_t>(aSlot.nContextLength, sizeof(aSlot.aData)-nPrefixLength);
+                auto nLength = std::min<size_t>(aSlot.nLength, sizeof(aSlot.aData)-nPrefixLength-nContextLength);
+                rec.sPrefix.assign(aSlot.aData, nPrefixLength);
+                rec.sContext.assign(aSlot.aData+nPrefixLength, nContextLength);
+                rec.sMessage.assign(aSlot.aData+nPrefixLength+nContextLength, nLength);
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if(aSlot.nSequence.load(std::memory_order_relaxed) == nSequence)
+                {
+                    rec.tp = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(nTime)));
+                    rec.level = static_cast<Level>(nLevel);
+                    rec.bTruncated = bTruncated;
+                    ++nCursor;
+                    return true;
+                }
+            }
+            //the writer has lapped us and overwritten the slot. Go round again to skip ahead
+            if(GetHead()-nCursor <= m_nMask)
+            {
+                ++nOverrun;
+                ++nCursor;
+            }
+        }
+    }
+}
+
+static size_t RoundUpPowerOf2(size_t nValue)
+{
+    size_t nPower = 2;
+    while(nPower < nValue)
+    {
+        nPower <<= 1;
+    }
+    return nPower;
+}
+
+Broadcast::Broadcast(size_t nSlots) : Output(kTsNone),
+m_pRing(std::make_shared<detail::BroadcastRing>(RoundUpPowerOf2(nSlots)))
+{
+}
+
+Broadcast::Subscriber Broadcast::Subscribe() const
+{
+    return Subscriber(m_pRing);
+}
+
+void Broadcast::DoOutputMessage(Level level, const std::string&  sLog, const std::string& sPrefix)
+{
+    std::string_view sv(sLog);
+    while(sv.empty() == false && (sv.back() == '\n' || sv.back() == '\r'))
+    {
+        sv.remove_suffix(1);
+    }
+    auto pContext = GetContext();
+    m_pRing->Write(GetTime(), level, sv, sPrefix, pContext ? std::string_view(pContext->GetText()) : std::string_view());
+}
+
+Broadcast::Subscriber::Subscriber(std::shared_ptr<detail::BroadcastRing> pRing) : m_pRing(std::move(pRing)),
+m_nCursor(m_pRing->GetHead())
+{
+}
+
+bool Broadcast::Subscriber::Next(Record& rec)
+{
+    return m_pRing->Read(m_nCursor, m_nOverrun, rec);
+}
+
+void Broadcast::Subscriber::SkipToLatest()
+{
+    m_nCursor = m_pRing->GetHead();
+}
+
+void Broadcast::Subscriber::SkipToOldest()
+{
+    m_nCursor = m_pRing->GetOldest();
+}
+
+}
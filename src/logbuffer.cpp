@@ -0,0 +1,258 @@
+#include "logbuffer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace pml::log::detail
+{
+
+RecordPool::RecordPool(uint32_t nSlots, size_t nCapacity) : m_nSlots(std::max(nSlots, uint32_t(1))), m_nCapacity(std::max(nCapacity, size_t(1))),
+    m_pData(new char[static_cast<size_t>(m_nSlots)*m_nCapacity]),
+    m_pNext(new std::atomic<uint32_t>[m_nSlots]),
+    m_nHead(0)
+{
+    for(uint32_t i = 0; i < m_nSlots; i++)
+    {
+        m_pNext[i] = (i+1 < m_nSlots) ? i+1 : kNoSlot;
+    }
+}
+
+uint32_t RecordPool::Claim()
+{
+    auto nHead = m_nHead.load(std::memory_order_acquire);
+    while(true)
+    {
+        auto nSlot = static_cast<uint32_t>(nHead);
+        if(nSlot == kNoSlot)
+        {
+            ++m_nExhausted;
+            return kNoSlot;
+        }
+        auto nNext = (((nHead >> 32)+1) << 32) | m_pNext[nSlot].load(std::memory_order_relaxed);
+        if(m_nHead.compare_exchange_weak(nHead, nNext, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            return nSlot;
+        }
+    }
+}
+
+void RecordPool::Release(uint32_t nSlot)
+{
+    auto nHead = m_nHead.load(std::memory_order_relaxed);
+    while(true)
+    {
+        m_pNext[nSlot].store(static_cast<uint32_t>(nHead), std::memory_order_relaxed);
+        auto nNew = (((nHead >> 32)+1) << 32) | nSlot;
+        if(m_nHead.compare_exchange_weak(nHead, nNew, std::memory_order_release, std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+}
+
+
+MessageBuffer::MessageBuffer(RecordPool* pPool) : m_pPool(pPool)
+{
+    if(m_pPool)
+    {
+        setp(nullptr, nullptr);
+    }
+    else
+    {
+        UseInline();
+    }
+}
+
+MessageBuffer::MessageBuffer(MessageBuffer&& other) noexcept : std::streambuf(other), m_pPool(other.m_pPool)
+{
+    TakeFrom(other);
+}
+
+MessageBuffer& MessageBuffer::operator=(MessageBuffer&& other) noexcept
+{
+    if(&other != this)
+    {
+        if(m_nSlot != RecordPool::kNoSlot)
+        {
+            m_pPool->Release(m_nSlot);
+        }
+        m_pPool = other.m_pPool;
+        TakeFrom(other);
+    }
+    return *this;
+}
+
+void MessageBuffer::TakeFrom(MessageBuffer& other)
+{
+    auto nLength = other.GetLength();
+    m_pHeap = std::move(other.m_pHeap);
+    m_nHeapCapacity = other.m_nHeapCapacity;
+    m_nSlot = other.m_nSlot;
+    m_bDropped = other.m_bDropped;
+    m_bTruncated = other.m_bTruncated;
+
+    if(other.IsInline())
+    {
+        std::memcpy(m_aInline, other.m_aInline, nLength);
+        UseInline();
+    }
+    else if(m_pHeap)
+    {
+        setp(m_pHeap.get(), m_pHeap.get()+m_nHeapCapacity);
+    }
+    else if(m_nSlot != RecordPool::kNoSlot)
+    {
+        auto pData = m_pPool->GetData(m_nSlot);
+        setp(pData, pData+m_pPool->GetCapacity());
+    }
+    else
+    {
+        setp(nullptr, nullptr);
+    }
+    pbump(static_cast<int>(nLength));
+
+    other.m_nHeapCapacity = 0;
+    other.m_nSlot = RecordPool::kNoSlot;
+    other.m_bDropped = false;
+    other.m_bTruncated = false;
+    if(other.m_pPool)
+    {
+        other.setp(nullptr, nullptr);
+    }
+    else
+    {
+        other.UseInline();
+    }
+}
+
+void MessageBuffer::UseInline()
+{
+    setp(m_aInline, m_aInline+kInlineCapacity);
+}
+
+MessageBuffer::~MessageBuffer()
+{
+    if(m_nSlot != RecordPool::kNoSlot)
+    {
+        m_pPool->Release(m_nSlot);
+    }
+}
+
+void MessageBuffer::Clear()
+{
+    setp(pbase(), epptr());
+    m_bDropped = false;
+    m_bTruncated = false;
+}
+
+std::unique_ptr<char[]> MessageBuffer::TakeHeap()
+{
+    m_nHeapCapacity = 0;
+    UseInline();
+    return std::move(m_pHeap);
+}
+
+uint32_t MessageBuffer::TakeSlot()
+{
+    if(m_bTruncated && GetLength() != 0)
+    {
+        //the line ending was cut off with the rest of the message
+        pptr()[-1] = '\n';
+    }
+    auto nSlot = m_nSlot;
+    m_nSlot = RecordPool::kNoSlot;
+    setp(nullptr, nullptr);
+    m_bDropped = false;
+    m_bTruncated = false;
+    return nSlot;
+}
+
+bool MessageBuffer::Grow(size_t nNeeded)
+{
+    if(m_pPool)
+    {
+        if(m_nSlot == RecordPool::kNoSlot && m_bDropped == false)
+        {
+            m_nSlot = m_pPool->Claim();
+            if(m_nSlot != RecordPool::kNoSlot)
+            {
+                auto pData = m_pPool->GetData(m_nSlot);
+                setp(pData, pData+m_pPool->GetCapacity());
+                return true;
+            }
+            m_bDropped = true;
+        }
+        else if(m_nSlot != RecordPool::kNoSlot && m_bTruncated == false)
+        {
+            m_bTruncated = true;
+            ++m_pPool->m_nTruncated;
+        }
+        return false;
+    }
+
+    auto nLength = GetLength();
+    auto nCapacity = std::max({size_t(256), m_nHeapCapacity*2, nLength+nNeeded});
+    std::unique_ptr<char[]> pHeap(new char[nCapacity]);
+    if(nLength != 0)
+    {
+        std::memcpy(pHeap.get(), pbase(), nLength);
+    }
+
+    m_pHeap = std::move(pHeap);
+    m_nHeapCapacity = nCapacity;
+    setp(m_pHeap.get(), m_pHeap.get()+m_nHeapCapacity);
+    pbump(static_cast<int>(nLength));
+    return true;
+}
+
+char* MessageBuffer::Reserve(size_t nLength)
+{
+    if(static_cast<size_t>(epptr()-pptr()) < nLength)
+    {
+        //a claimed pool slot cannot grow
+        if((m_pPool && m_nSlot != RecordPool::kNoSlot) || Grow(nLength) == false || static_cast<size_t>(epptr()-pptr()) < nLength)
+        {
+            return nullptr;
+        }
+    }
+    return pptr();
+}
+
+MessageBuffer::int_type MessageBuffer::overflow(int_type c)
+{
+    if(traits_type::eq_int_type(c, traits_type::eof()))
+    {
+        return traits_type::not_eof(c);
+    }
+    //a full slot swallows the rest of the message rather than putting the stream in to a failed state
+    if(pptr() != epptr() || Grow(1))
+    {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return c;
+}
+
+std::streamsize MessageBuffer::xsputn(const char* pData, std::streamsize nLength)
+{
+    auto nLeft = static_cast<size_t>(nLength);
+    while(nLeft > 0)
+    {
+        auto nSpace = static_cast<size_t>(epptr()-pptr());
+        if(nSpace == 0)
+        {
+            if(Grow(nLeft) == false)
+            {
+                break;
+            }
+            continue;
+        }
+        auto nCopy = std::min(nSpace, nLeft);
+        std::memcpy(pptr(), pData, nCopy);
+        pbump(static_cast<int>(nCopy));
+        pData += nCopy;
+        nLeft -= nCopy;
+    }
+    return nLength;
+}
+
+}
@@ -0,0 +1,438 @@
+#include "logcollector.h"
+
+#ifdef __linux__
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <thread>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logmanager.h"
+#include "logshm.h"
+
+namespace pml::log
+{
+namespace detail
+{
+    /** @brief reads the ring of one SharedMemory output. At most one message is decoded ahead so that the Collector can compare the next message of every ring.
+    *   The tail in the segment is only moved past messages that have been passed on, so a collector that stops never loses a message it had decoded
+    **/
+    class ShmReader
+    {
+        public:
+            static std::unique_ptr<ShmReader> Open(const std::string& sName);
+            ~ShmReader();
+
+            bool Next();
+            void Pop() { m_bPending = false; }
+
+            int64_t GetTime() const { return m_nTime; }
+            Level GetLevel() const { return m_level; }
+            const std::string& GetPrefix() const { return m_sPrefix; }
+            const std::string& GetMessage() const { return m_sMessage; }
+
+            bool ContextChanged() const { return m_bContextChanged; }
+            const std::string& GetEncodedContext() const { return m_sContext; }
+            void SetContext(ContextPtr pContext) { m_pContext = std::move(pContext); m_bContextChanged = false; }
+            const Context* GetContext() const { return m_pContext.get(); }
+
+            const std::string& GetName() const { return m_sName; }
+            ino_t GetInode() const { return m_nInode; }
+            uint64_t GetDropped() const { return m_pHeader->nDropped.load(std::memory_order_relaxed); }
+
+            void Commit(int64_t nSeen);
+            void CheckGone(bool bCheckProcess);
+            void SetReplaced() { m_bReplaced = true; m_bGone = true; }
+            bool IsGone() const { return m_bGone; }
+            bool IsFinished() const;
+            void Unlink() const;
+
+        private:
+            ShmReader(std::string sName, ino_t nInode, ShmHeader* pHeader);
+
+            std::string m_sName;
+            ino_t m_nInode;
+            ShmHeader* m_pHeader;
+            const char* m_pRing;
+            uint64_t m_nMask;
+            uint64_t m_nTail;           ///< the bytes decoded
+            uint64_t m_nPendingStart;   ///< where the decoded message that has not been passed on yet starts
+
+            bool m_bPending = false;
+            int64_t m_nTime = 0;
+            Level m_level = Level::kInfo;
+            std::string m_sPrefix;
+            std::string m_sMessage;
+            std::string m_sContext;     ///< the context as it is encoded in the ring, so it is only decoded again when it changes
+            bool m_bContextChanged = false;
+            ContextPtr m_pContext;
+
+            bool m_bGone = false;       ///< the producer will not write any more
+            bool m_bReplaced = false;   ///< a new segment has been created with the same name, so this one must not be unlinked
+    };
+
+    std::unique_ptr<ShmReader> ShmReader::Open(const std::string& sName)
+    {
+        auto nFd = shm_open(("/"+sName).c_str(), O_RDWR, 0);
+        if(nFd == -1)
+        {
+            return nullptr;
+        }
+
+        struct stat info;
+        void* pSegment = MAP_FAILED;
+        if(fstat(nFd, &info) == 0 && static_cast<uint64_t>(info.st_size) > ShmHeader::kSize)
+        {
+            pSegment = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, nFd, 0);
+        }
+        close(nFd);
+        if(pSegment == MAP_FAILED)
+        {
+            return nullptr;
+        }
+
+        //a segment that is still being set up or is not ours is left until the next time the collector looks
+        auto pHeader = static_cast<ShmHeader*>(pSegment);
+        auto nCapacity = pHeader->nCapacity;
+        if(pHeader->nMagic.load(std::memory_order_acquire) != ShmHeader::kMagic || (nCapacity & (nCapacity-1)) != 0 || ShmHeader::kSize+nCapacity != static_cast<uint64_t>(info.st_size))
+        {
+            munmap(pSegment, info.st_size);
+            return nullptr;
+        }
+        return std::unique_ptr<ShmReader>(new ShmReader(sName, info.st_ino, pHeader));
+    }
+
+    ShmReader::ShmReader(std::string sName, ino_t nInode, ShmHeader* pHeader) : m_sName(std::move(sName)),
+    m_nInode(nInode),
+    m_pHeader(pHeader),
+    m_pRing(reinterpret_cast<const char*>(pHeader)+ShmHeader::kSize),
+    m_nMask(pHeader->nCapacity-1),
+    m_nTail(pHeader->nTail.load(std::memory_order_acquire)),
+    m_nPendingStart(m_nTail)
+    {
+    }
+
+    ShmReader::~ShmReader()
+    {
+        munmap(m_pHeader, ShmHeader::kSize+m_nMask+1);
+    }
+
+    bool ShmReader::Next()
+    {
+        if(m_bPending)
+        {
+            return true;
+        }
+
+        auto nHead = m_pHeader->nHead.load(std::memory_order_acquire);
+        while(m_nTail < nHead)
+        {
+            auto nOffset = m_nTail & m_nMask;
+            auto nToEnd = m_nMask+1-nOffset;
+
+            uint32_t nLength;
+            std::memcpy(&nLength, m_pRing+nOffset, sizeof(nLength));
+            if(nLength == ShmRecord::kPadding)
+            {
+                m_nTail += nToEnd;
+                continue;
+            }
+
+            ShmRecord record;
+            std::memcpy(&record, m_pRing+nOffset, sizeof(record));
+            if(nLength < sizeof(record) || nLength > nHead-m_nTail || nLength > nToEnd ||
+               sizeof(record)+uint64_t(record.nPrefixLength)+record.nContextLength+record.nMessageLength > nLength)
+            {
+                std::cout << "Shared memory " << m_sName << " is corrupt. Skipping " << (nHead-m_nTail) << " bytes" << std::endl;
+                m_nTail = nHead;
+                break;
+            }
+
+            auto pData = m_pRing+nOffset+sizeof(record);
+            m_nTime = record.nTime;
+            m_level = static_cast<Level>(std::min<uint8_t>(record.nLevel, static_cast<uint8_t>(Level::kCritical)));
+            m_sPrefix.assign(pData, record.nPrefixLength);
+            pData += record.nPrefixLength;
+            if(std::string_view(pData, record.nContextLength) != m_sContext)
+            {
+                m_sContext.assign(pData, record.nContextLength);
+                m_bContextChanged = true;
+            }
+            pData += record.nContextLength;
+            m_sMessage.assign(pData, record.nMessageLength);
+
+            m_nPendingStart = m_nTail;
+            m_nTail += nLength;
+            m_bPending = true;
+            return true;
+        }
+        return false;
+    }
+
+    void ShmReader::Commit(int64_t nSeen)
+    {
+        m_pHeader->nTail.store(m_bPending ? m_nPendingStart : m_nTail, std::memory_order_release);
+        m_pHeader->nCollectorSeen.store(nSeen, std::memory_order_relaxed);
+    }
+
+    void ShmReader::CheckGone(bool bCheckProcess)
+    {
+        if(m_bGone == false)
+        {
+            m_bGone = m_pHeader->nClosed.load(std::memory_order_acquire) != 0 ||
+                      (bCheckProcess && kill(static_cast<pid_t>(m_pHeader->nPid), 0) == -1 && errno == ESRCH);
+        }
+    }
+
+    bool ShmReader::IsFinished() const
+    {
+        //nHead is read after the producer was seen to be gone so it cannot move on again
+        return m_bGone && m_bPending == false && m_nTail >= m_pHeader->nHead.load(std::memory_order_acquire);
+    }
+
+    void ShmReader::Unlink() const
+    {
+        struct stat info;
+        if(m_bReplaced == false && stat(("/dev/shm/"+m_sName).c_str(), &info) == 0 && info.st_ino == m_nInode)
+        {
+            shm_unlink(("/"+m_sName).c_str());
+        }
+    }
+}
+
+static std::vector<Context::Entry> DecodeContext(const std::string& sEncoded)
+{
+    std::vector<Context::Entry> vEntries;
+    size_t nPosition = 0;
+    auto readString = [&sEncoded, &nPosition](std::string& sValue)
+    {
+        uint16_t nLength;
+        if(nPosition+sizeof(nLength) > sEncoded.size())
+        {
+            return false;
+        }
+        std::memcpy(&nLength, sEncoded.data()+nPosition, sizeof(nLength));
+        nPosition += sizeof(nLength);
+        if(nPosition+nLength > sEncoded.size())
+        {
+            return false;
+        }
+        sValue.assign(sEncoded, nPosition, nLength);
+        nPosition += nLength;
+        return true;
+    };
+
+    Context::Entry entry;
+    while(readString(entry.first) && readString(entry.second))
+    {
+        vEntries.push_back(std::move(entry));
+    }
+    return vEntries;
+}
+
+Collector::Collector(const std::string& sChannel, std::chrono::milliseconds window) : m_sPrefix("pml_log."+sChannel+"."),
+m_window(window),
+m_discover(std::clamp(window/2, std::chrono::milliseconds(5), std::chrono::milliseconds(1000))),
+m_pRenderer(std::make_unique<detail::Renderer>())
+{
+}
+
+Collector::~Collector()
+{
+    Commit();
+}
+
+void Collector::AddOutput(std::unique_ptr<Output> pOutput)
+{
+    m_vOutputs.push_back(std::move(pOutput));
+}
+
+uint64_t Collector::GetDropped() const
+{
+    uint64_t nDropped = 0;
+    for(const auto& pReader : m_vReaders)
+    {
+        nDropped += pReader->GetDropped();
+    }
+    return nDropped;
+}
+
+void Collector::Discover()
+{
+    auto pDir = opendir("/dev/shm");
+    if(pDir == nullptr)
+    {
+        std::cout << "Could not open /dev/shm\t" << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    while(auto pEntry = readdir(pDir))
+    {
+        std::string sName(pEntry->d_name);
+        if(sName.compare(0, m_sPrefix.size(), m_sPrefix) != 0)
+        {
+            continue;
+        }
+
+        struct stat info;
+        if(stat(("/dev/shm/"+sName).c_str(), &info) != 0)
+        {
+            continue;
+        }
+
+        auto itReader = std::find_if(m_vReaders.begin(), m_vReaders.end(), [&sName](const auto& pReader){ return pReader->GetName() == sName; });
+        if(itReader != m_vReaders.end())
+        {
+            if((*itReader)->GetInode() == info.st_ino)
+            {
+                continue;
+            }
+            //the producer died without removing its segment and a new process with the same pid has made a new one
+            (*itReader)->SetReplaced();
+        }
+
+        if(auto pReader = detail::ShmReader::Open(sName); pReader)
+        {
+            m_vReaders.push_back(std::move(pReader));
+        }
+    }
+    closedir(pDir);
+
+    for(auto& pReader : m_vReaders)
+    {
+        pReader->CheckGone(true);
+    }
+}
+
+size_t Collector::Poll()
+{
+    auto tpNow = std::chrono::steady_clock::now();
+    if(tpNow >= m_tpDiscover)
+    {
+        Discover();
+        m_tpDiscover = tpNow+m_discover;
+    }
+
+    //a live producer with nothing waiting may still publish an older message, so only wait for it as long as the window.
+    //a process that has not been found yet may have written messages since the last time the collector looked, so even when every producer has a message waiting hold back the newest ones
+    auto nNow = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    auto nCutoff = nNow-std::chrono::duration_cast<std::chrono::nanoseconds>(m_window).count();
+    auto nSettled = nNow-std::chrono::duration_cast<std::chrono::nanoseconds>(m_discover).count();
+
+    size_t nPassed = 0;
+    while(true)
+    {
+        detail::ShmReader* pEarliest = nullptr;
+        bool bAllWaiting = true;
+        for(auto& pReader : m_vReaders)
+        {
+            if(pReader->Next())
+            {
+                if(pEarliest == nullptr || pReader->GetTime() < pEarliest->GetTime())
+                {
+                    pEarliest = pReader.get();
+                }
+            }
+            else if(pReader->IsGone() == false)
+            {
+                bAllWaiting = false;
+            }
+        }
+
+        if(pEarliest == nullptr || pEarliest->GetTime() > (bAllWaiting ? nSettled : nCutoff))
+        {
+            break;
+        }
+
+        Pass(*pEarliest);
+        ++nPassed;
+
+        //let the producers reuse their rings while a large backlog is worked through
+        if(nPassed % 4096 == 0)
+        {
+            Commit();
+        }
+    }
+
+    if(nPassed != 0)
+    {
+        for(auto& pOutput : m_vOutputs)
+        {
+            pOutput->MessagesDone();
+        }
+    }
+    Commit();
+    return nPassed;
+}
+
+void Collector::Pass(detail::ShmReader& reader)
+{
+    if(reader.ContextChanged())
+    {
+        auto vEntries = DecodeContext(reader.GetEncodedContext());
+        if(vEntries.empty())
+        {
+            reader.SetContext(detail::ContextPtr());
+        }
+        else
+        {
+            //a new Context starts with one reference, which the ContextPtr takes over
+            auto pContext = new Context(std::move(vEntries));
+            reader.SetContext(detail::ContextPtr(pContext));
+            pContext->Release();
+        }
+    }
+
+    auto nPrefix = PrefixRegistry::Get().Intern(reader.GetPrefix());
+    auto tp = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(reader.GetTime())));
+    m_pRenderer->Start(tp, reader.GetLevel(), reader.GetPrefix(), reader.GetMessage(), reader.GetContext());
+    for(auto& pOutput : m_vOutputs)
+    {
+        if(pOutput->Accepts(reader.GetLevel(), nPrefix))
+        {
+            pOutput->OutputMessage(reader.GetLevel(), reader.GetMessage(), reader.GetPrefix(), reader.GetContext(), m_pRenderer.get());
+        }
+    }
+    reader.Pop();
+}
+
+void Collector::Commit()
+{
+    auto nSeen = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    for(auto& pReader : m_vReaders)
+    {
+        pReader->Commit(nSeen);
+        pReader->CheckGone(false);
+    }
+
+    m_vReaders.erase(std::remove_if(m_vReaders.begin(), m_vReaders.end(), [](const auto& pReader){
+        if(pReader->IsFinished())
+        {
+            pReader->Unlink();
+            return true;
+        }
+        return false;
+    }), m_vReaders.end());
+}
+
+void Collector::Run(const std::atomic_bool& bRun)
+{
+    while(bRun)
+    {
+        if(Poll() == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+}
+#endif
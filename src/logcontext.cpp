@@ -0,0 +1,63 @@
+#include "logcontext.h"
+
+namespace pml::log
+{
+
+static thread_local const Context* t_pContext = nullptr;    ///< the innermost ScopedContext of the thread
+static std::atomic<uint64_t> g_nContextVersion{1};
+
+Context::Context(const Context* pParent, std::string sKey, std::string sValue) : m_nVersion(g_nContextVersion.fetch_add(1, std::memory_order_relaxed))
+{
+    if(pParent)
+    {
+        m_vEntries.reserve(pParent->m_vEntries.size()+1);
+        m_vEntries.insert(m_vEntries.end(), pParent->m_vEntries.begin(), pParent->m_vEntries.end());
+        m_sText = pParent->m_sText;
+        m_sText += " ";
+    }
+    m_sText += sKey;
+    m_sText += "=";
+    m_sText += sValue;
+    m_vEntries.emplace_back(std::move(sKey), std::move(sValue));
+}
+
+Context::Context(std::vector<Entry> vEntries) : m_vEntries(std::move(vEntries)), m_nVersion(g_nContextVersion.fetch_add(1, std::memory_order_relaxed))
+{
+    for(const auto& entry : m_vEntries)
+    {
+        if(m_sText.empty() == false)
+        {
+            m_sText += " ";
+        }
+        m_sText += entry.first;
+        m_sText += "=";
+        m_sText += entry.second;
+    }
+}
+
+const Context* Context::Current()
+{
+    return t_pContext;
+}
+
+void Context::Release() const
+{
+    if(m_nRefs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        delete this;
+    }
+}
+
+ScopedContext::ScopedContext(std::string sKey, std::string sValue) : m_pContext(new Context(t_pContext, std::move(sKey), std::move(sValue))),
+m_pPrevious(t_pContext)
+{
+    t_pContext = m_pContext;
+}
+
+ScopedContext::~ScopedContext()
+{
+    t_pContext = m_pPrevious;
+    m_pContext->Release();
+}
+
+}
@@ -0,0 +1,54 @@
+#include "log.h"
+#include "logmanager.h"
+
+namespace pml::log
+{
+
+Logger::Logger(const std::string& sName) : m_prefix(sName)
+{
+    auto nId = Manager::Get().RegisterLogger(sName);
+    m_nId = nId.value_or(0);
+    m_bRegistered = nId.has_value();
+}
+
+void Logger::SetLevel(Level level)
+{
+    if(m_bRegistered)
+    {
+        Manager::Get().SetLoggerLevel(m_nId, level);
+    }
+}
+
+void Logger::RouteTo(const std::vector<size_t>& vOutputs)
+{
+    if(m_bRegistered)
+    {
+        Manager::Get().SetLoggerRoutes(m_nId, std::set<size_t>(vOutputs.begin(), vOutputs.end()));
+    }
+}
+
+void Logger::AddRoute(size_t nOutput)
+{
+    if(m_bRegistered)
+    {
+        Manager::Get().AddLoggerRoute(m_nId, nOutput, true);
+    }
+}
+
+void Logger::RemoveRoute(size_t nOutput)
+{
+    if(m_bRegistered)
+    {
+        Manager::Get().AddLoggerRoute(m_nId, nOutput, false);
+    }
+}
+
+void Logger::RouteToAll()
+{
+    if(m_bRegistered)
+    {
+        Manager::Get().SetLoggerRoutes(m_nId, std::nullopt);
+    }
+}
+
+}
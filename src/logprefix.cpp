@@ -0,0 +1,74 @@
+#include "log.h"
+#include "logmanager.h"
+
+namespace pml::log
+{
+
+PrefixRegistry& PrefixRegistry::Get()
+{
+    static PrefixRegistry registry;
+    return registry;
+}
+
+PrefixRegistry::PrefixRegistry()
+{
+    //id 0 is always the empty prefix
+    m_dNames.emplace_back();
+    m_mIds.insert(std::make_pair(std::string(), 0));
+    m_aNames[0] = &m_dNames.back();
+    m_nCount = 1;
+}
+
+uint16_t PrefixRegistry::Intern(const std::string& sName)
+{
+    if(sName.empty())
+    {
+        return 0;
+    }
+
+    //each thread keeps its own cache so that prefixes passed as strings only take the lock the first time a thread uses them
+    thread_local std::unordered_map<std::string, uint16_t> mCache;
+    if(auto itCache = mCache.find(sName); itCache != mCache.end())
+    {
+        return itCache->second;
+    }
+
+    uint16_t nId;
+    {
+        std::lock_guard<std::mutex> lg(m_mutex);
+        if(auto itId = m_mIds.find(sName); itId != m_mIds.end())
+        {
+            nId = itId->second;
+        }
+        else if(auto nCount = m_nCount.load(); nCount < Prefix::kMaxPrefixes)
+        {
+            nId = nCount;
+            m_dNames.push_back(sName);
+            m_mIds.insert(std::make_pair(sName, nId));
+            m_aNames[nId].store(&m_dNames.back(), std::memory_order_release);
+            m_nCount.store(nCount+1, std::memory_order_release);
+        }
+        else
+        {
+            return Prefix::kUnregistered;
+        }
+    }
+    mCache.insert(std::make_pair(sName, nId));
+    return nId;
+}
+
+
+Prefix::Prefix(const std::string& sName) : m_nId(PrefixRegistry::Get().Intern(sName))
+{
+    if(m_nId == kUnregistered)
+    {
+        m_sName = sName;
+    }
+}
+
+const std::string& Prefix::GetName() const
+{
+    return m_nId == kUnregistered ? m_sName : PrefixRegistry::Get().GetName(m_nId);
+}
+
+}
@@ -0,0 +1,83 @@
+#include "log.h"
+#include "logmanager.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace pml::log
+{
+
+void ApplyThreadConfig(const std::string& sName)
+{
+    Manager::DoApplyThreadConfig(Manager::Get().GetThreadConfig(), sName);
+}
+
+void Manager::SetThreadConfig(const ThreadConfig& config)
+{
+    {
+        std::lock_guard<std::mutex> lg(m_mutexControl);
+        m_threadConfig = config;
+    }
+    m_bThreadConfigChanged = true;
+}
+
+ThreadConfig Manager::GetThreadConfig()
+{
+    std::lock_guard<std::mutex> lg(m_mutexControl);
+    return m_threadConfig;
+}
+
+void Manager::DoApplyThreadConfig(const ThreadConfig& config, const std::string& sName)
+{
+#ifdef __linux__
+    auto thread = pthread_self();
+
+    if(config.vCpus.empty() == false)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for(auto nCpu : config.vCpus)
+        {
+            if(nCpu >= 0 && nCpu < CPU_SETSIZE)
+            {
+                CPU_SET(nCpu, &cpus);
+            }
+        }
+        if(auto nError = pthread_setaffinity_np(thread, sizeof(cpus), &cpus); nError != 0)
+        {
+            std::cout << "Could not set thread affinity\t" << std::strerror(nError) << std::endl;
+        }
+    }
+
+    if(config.policy != ThreadConfig::Policy::kDefault)
+    {
+        sched_param param{};
+        if(auto nError = pthread_setschedparam(thread, config.policy == ThreadConfig::Policy::kBatch ? SCHED_BATCH : SCHED_IDLE, &param); nError != 0)
+        {
+            std::cout << "Could not set thread scheduling policy\t" << std::strerror(nError) << std::endl;
+        }
+    }
+
+    //on Linux the nice value belongs to the thread rather than the process
+    if(config.nice && setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), *config.nice) != 0)
+    {
+        std::cout << "Could not set thread nice value\t" << std::strerror(errno) << std::endl;
+    }
+
+    pthread_setname_np(thread, (sName.empty() ? config.sName : sName).substr(0, 15).c_str());
+#else
+    (void)config;
+    (void)sName;
+#endif
+}
+
+}
@@ -0,0 +1,1005 @@
+#include "logtoasyncfile.h"
+
+#ifdef __linux__
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace pml::log
+{
+namespace detail
+{
+    /** @brief the minimum needed to drive an io_uring instance with the raw system calls so that there is no dependency on liburing
+    **/
+    class Uring
+    {
+        public:
+            ~Uring();
+
+            bool Init(unsigned int nEntries);
+            bool RegisterBuffers(const std::vector<iovec>& vBuffers);
+
+            /** @brief checks that the kernel supports all the given operations. Kernels older than 5.6 can't be asked and are treated as supporting none
+            **/
+            bool Supports(std::initializer_list<unsigned int> lstOps);
+
+            /** @brief returns a cleared submission queue entry or nullptr if the queue is full
+            **/
+            io_uring_sqe* GetSqe();
+
+            /** @brief returns the number of entries that can be got before the submission queue is full
+            **/
+            unsigned int GetSpace() const { return m_nSqEntries-(m_nSqTail-__atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE)); }
+
+            /** @brief takes back the entries that the kernel has not consumed yet and calls the function for each of them. Only safe once nothing will be submitted to the ring again
+            **/
+            template<typename F> void Withdraw(F func)
+            {
+                auto nHead = __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE);
+                for(auto nTail = nHead; nTail != m_nSqTail; ++nTail)
+                {
+                    func(m_pSqes[m_pSqArray[nTail & m_nSqMask]]);
+                }
+                m_nSqTail = nHead;
+                m_nToSubmit = 0;
+                __atomic_store_n(m_pSqTail, m_nSqTail, __ATOMIC_RELEASE);
+            }
+
+            /** @brief submits all the entries got since the last call and optionally waits for at least one completion
+            **/
+            int Submit(bool bWait);
+
+            /** @brief calls the function for each completion that is ready. Each completion is consumed before the function is called so the function can submit more work
+            **/
+            template<typename F> unsigned int Reap(F func)
+            {
+                unsigned int nCount = 0;
+                for(auto nHead = *m_pCqHead; nHead != __atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE); nHead = *m_pCqHead, ++nCount)
+                {
+                    auto cqe = m_pCqes[nHead & m_nCqMask];
+                    __atomic_store_n(m_pCqHead, nHead+1, __ATOMIC_RELEASE);
+                    func(cqe);
+                }
+                return nCount;
+            }
+
+        private:
+            int m_nFd = -1;
+            void* m_pSqRing = MAP_FAILED;
+            void* m_pCqRing = MAP_FAILED;
+            size_t m_nSqRingSize = 0;
+            size_t m_nCqRingSize = 0;
+            io_uring_sqe* m_pSqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+            size_t m_nSqesSize = 0;
+
+            unsigned int* m_pSqHead = nullptr;
+            unsigned int* m_pSqTail = nullptr;
+            unsigned int* m_pSqArray = nullptr;
+            unsigned int m_nSqMask = 0;
+            unsigned int m_nSqEntries = 0;
+            unsigned int m_nSqTail = 0;
+            unsigned int m_nToSubmit = 0;
+
+            unsigned int* m_pCqHead = nullptr;
+            unsigned int* m_pCqTail = nullptr;
+            io_uring_cqe* m_pCqes = nullptr;
+            unsigned int m_nCqMask = 0;
+    };
+
+    Uring::~Uring()
+    {
+        if(m_pSqes != MAP_FAILED)
+        {
+            munmap(m_pSqes, m_nSqesSize);
+        }
+        if(m_pCqRing != MAP_FAILED && m_pCqRing != m_pSqRing)
+        {
+            munmap(m_pCqRing, m_nCqRingSize);
+        }
+        if(m_pSqRing != MAP_FAILED)
+        {
+            munmap(m_pSqRing, m_nSqRingSize);
+        }
+        if(m_nFd != -1)
+        {
+            close(m_nFd);
+        }
+    }
+
+    bool Uring::Init(unsigned int nEntries)
+    {
+        io_uring_params params{};
+        m_nFd = static_cast<int>(syscall(__NR_io_uring_setup, nEntries, &params));
+        if(m_nFd < 0)
+        {
+            m_nFd = -1;
+            return false;
+        }
+
+        m_nSqRingSize = params.sq_off.array + params.sq_entries*sizeof(unsigned int);
+        m_nCqRingSize = params.cq_off.cqes + params.cq_entries*sizeof(io_uring_cqe);
+        if(params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            m_nSqRingSize = m_nCqRingSize = std::max(m_nSqRingSize, m_nCqRingSize);
+        }
+
+        m_pSqRing = mmap(nullptr, m_nSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_nFd, IORING_OFF_SQ_RING);
+        if(m_pSqRing == MAP_FAILED)
+        {
+            return false;
+        }
+        if(params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            m_pCqRing = m_pSqRing;
+        }
+        else if((m_pCqRing = mmap(nullptr, m_nCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_nFd, IORING_OFF_CQ_RING)) == MAP_FAILED)
+        {
+            return false;
+        }
+
+        m_nSqesSize = params.sq_entries*sizeof(io_uring_sqe);
+        m_pSqes = static_cast<io_uring_sqe*>(mmap(nullptr, m_nSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_nFd, IORING_OFF_SQES));
+        if(m_pSqes == MAP_FAILED)
+        {
+            return false;
+        }
+
+        auto pSq = static_cast<char*>(m_pSqRing);
+        m_pSqHead = reinterpret_cast<unsigned int*>(pSq + params.sq_off.head);
+        m_pSqTail = reinterpret_cast<unsigned int*>(pSq + params.sq_off.tail);
+        m_pSqArray = reinterpret_cast<unsigned int*>(pSq + params.sq_off.array);
+        m_nSqMask = *reinterpret_cast<unsigned int*>(pSq + params.sq_off.ring_mask);
+        m_nSqEntries = params.sq_entries;
+        m_nSqTail = *m_pSqTail;
+
+        auto pCq = static_cast<char*>(m_pCqRing);
+        m_pCqHead = reinterpret_cast<unsigned int*>(pCq + params.cq_off.head);
+        m_pCqTail = reinterpret_cast<unsigned int*>(pCq + params.cq_off.tail);
+        m_pCqes = reinterpret_cast<io_uring_cqe*>(pCq + params.cq_off.cqes);
+        m_nCqMask = *reinterpret_cast<unsigned int*>(pCq + params.cq_off.ring_mask);
+        return true;
+    }
+
+    bool Uring::RegisterBuffers(const std::vector<iovec>& vBuffers)
+    {
+        return syscall(__NR_io_uring_register, m_nFd, IORING_REGISTER_BUFFERS, vBuffers.data(), static_cast<unsigned int>(vBuffers.size())) == 0;
+    }
+
+    bool Uring::Supports(std::initializer_list<unsigned int> lstOps)
+    {
+        constexpr unsigned int kOps = 256;
+        std::vector<char> vProbe(sizeof(io_uring_probe)+kOps*sizeof(io_uring_probe_op), 0);
+        auto pProbe = reinterpret_cast<io_uring_probe*>(vProbe.data());
+        if(syscall(__NR_io_uring_register, m_nFd, IORING_REGISTER_PROBE, pProbe, kOps) != 0)
+        {
+            return false;
+        }
+        for(auto nOp : lstOps)
+        {
+            if(nOp > pProbe->last_op || (pProbe->ops[nOp].flags & IO_URING_OP_SUPPORTED) == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    io_uring_sqe* Uring::GetSqe()
+    {
+        auto nHead = __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE);
+        if(m_nSqTail - nHead >= m_nSqEntries)
+        {
+            return nullptr;
+        }
+        auto nIndex = m_nSqTail & m_nSqMask;
+        auto pSqe = &m_pSqes[nIndex];
+        std::memset(pSqe, 0, sizeof(io_uring_sqe));
+        m_pSqArray[nIndex] = nIndex;
+        ++m_nSqTail;
+        ++m_nToSubmit;
+        return pSqe;
+    }
+
+    int Uring::Submit(bool bWait)
+    {
+        __atomic_store_n(m_pSqTail, m_nSqTail, __ATOMIC_RELEASE);
+        int nResult;
+        do
+        {
+            nResult = static_cast<int>(syscall(__NR_io_uring_enter, m_nFd, m_nToSubmit, bWait ? 1 : 0, bWait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+        } while(nResult < 0 && errno == EINTR);
+
+        if(nResult > 0)
+        {
+            m_nToSubmit -= std::min(m_nToSubmit, static_cast<unsigned int>(nResult));
+        }
+        return nResult;
+    }
+
+
+    /** @brief owns the buffers and the file descriptors of an AsyncFile. A buffer is free, being filled, waiting for the file to open or being written.
+    *   Buffers are written at explicit offsets so writes that are in flight at the same time cannot be reordered in the file. A rolled over file is only closed once the last
+    *   write to it has completed, so the Manager thread never has to wait for the old file before the new one is opened
+    **/
+    class AsyncWriter
+    {
+        public:
+            AsyncWriter(size_t nBuffers, size_t nBufferSize);
+            ~AsyncWriter();
+
+            void Append(const char* pData, size_t nLength);
+            void Open(const std::string& sPath);
+            void Flush();
+            bool Commit(bool bSync);
+
+            bool IsUsingIoUring() const { return m_bUring; }
+            uint64_t GetErrors() const { return m_nErrors; }
+
+        private:
+            struct buffer
+            {
+                char* pData = nullptr;
+                uint32_t nUsed = 0;
+                uint32_t nWritten = 0;      ///< how much of a buffer being written has been written so far
+                uint64_t nOffset = 0;       ///< where in the file a buffer being written goes
+                int nFd = -1;               ///< the file a buffer being written goes to
+                bool bInFlight = false;     ///< being written
+                bool bInKernel = false;     ///< a write of it has been submitted to the ring and not completed yet, so the kernel may still be reading it
+            };
+
+            /** @brief a rolled over file that still has writes in flight
+            **/
+            struct closing
+            {
+                int nFd;
+                size_t nWrites;
+            };
+
+            static constexpr uint64_t kOpen = 1ull << 32;
+            static constexpr uint64_t kClose = 2ull << 32;     ///< the file descriptor is in the bottom 32 bits
+            static constexpr uint64_t kSync = 3ull << 32;
+            static constexpr uint64_t kStat = 4ull << 32;
+            static constexpr uint64_t kCloseSync = 5ull << 32; ///< the file descriptor is in the bottom 32 bits
+            static constexpr uint64_t kTypeMask = ~0xFFFFFFFFull;
+            static constexpr int kRollOver = -1;                ///< marks where the buffers waiting for the next file in m_dPaths start
+            static constexpr std::chrono::seconds kDrainTimeout{1};
+
+            int GetFreeBuffer();
+            void Queue(int nBuffer);
+            void SubmitWrite(int nBuffer);
+            bool SubmitRemainder(int nBuffer);
+            void WriteDone(int nBuffer);
+            void StartOpen(const std::string& sPath);
+            void SubmitOpen();
+            void OpenSync();
+            void Opened(int nResult, uint64_t nSize);
+            void CloseFile();
+            void Close(int nFd);
+            void Sync();
+            bool CreateDirectory();
+            void Release(int nBuffer);
+            io_uring_sqe* GetSqe();
+            bool Reserve(unsigned int nEntries);
+            void Reap(bool bWait);
+            void Completed(const io_uring_cqe& cqe);
+            bool InKernel() const;
+            static io_uring_cqe Cancelled(uint64_t nUserData);
+            void FallBack();
+            void WriteSync(int nFd, const char* pData, size_t nLength, uint64_t nOffset);
+
+            size_t m_nBufferSize;
+            std::unique_ptr<char[]> m_pMemory;
+            std::vector<std::unique_ptr<char[]>> m_vReplaced;   ///< memory given to buffers whose own memory the kernel may still be reading
+            std::vector<buffer> m_vBuffers;
+            std::vector<int> m_vFree;
+            std::deque<int> m_dPending;         ///< full buffers waiting for the file to open
+            std::deque<std::string> m_dPaths;   ///< the files to open, in order, once the one being opened has opened
+            int m_nCurrent = -1;                ///< the buffer being filled
+
+            Uring m_ring;
+            bool m_bUring = false;
+            bool m_bFixed = false;
+            bool m_bAbandoned = false;          ///< FallBack gave up waiting for the kernel so m_pMemory must never be freed
+            size_t m_nInFlight = 0;
+
+            int m_nFd = -1;
+            uint64_t m_nOffset = 0;
+            std::vector<closing> m_vClosing;
+            size_t m_nClosing = 0;              ///< syncs and closes of rolled over files submitted to the ring and not completed yet
+            bool m_bOpening = false;
+            bool m_bStatting = false;           ///< an open and the statx linked to it have been submitted to the ring and the statx has not completed yet
+            bool m_bRetried = false;            ///< the directory has been created after the open failed
+            int m_nOpenResult = 0;
+            bool m_bSyncing = false;
+            bool m_bUnfiled = false;            ///< a buffer since the last commit was written to the console as the file could not be opened
+            uint64_t m_nCommittedErrors = 0;    ///< m_nErrors at the last commit
+            std::unique_ptr<std::string> m_pOpenPath;       ///< the kernel reads the path and writes the statx result, so both are on the heap and must stay valid until the statx has completed
+            std::unique_ptr<struct statx> m_pStat;
+            std::atomic<uint64_t> m_nErrors{0};     ///< read by GetErrors from any thread
+    };
+
+    AsyncWriter::AsyncWriter(size_t nBuffers, size_t nBufferSize) : m_nBufferSize(std::max(nBufferSize, size_t(4096))),
+    m_pMemory(new char[std::max(nBuffers, size_t(1))*m_nBufferSize]),
+    m_vBuffers(std::max(nBuffers, size_t(1))),
+    m_pOpenPath(std::make_unique<std::string>()),
+    m_pStat(std::make_unique<struct statx>())
+    {
+        std::vector<iovec> vIov;
+        for(size_t i = 0; i < m_vBuffers.size(); i++)
+        {
+            m_vBuffers[i].pData = m_pMemory.get()+i*m_nBufferSize;
+            vIov.push_back({m_vBuffers[i].pData, m_nBufferSize});
+            m_vFree.push_back(static_cast<int>(m_vBuffers.size()-1-i));
+        }
+
+        //one entry per buffer plus the open, statx and close of a rollover and a sync
+        m_bUring = m_ring.Init(static_cast<unsigned int>(m_vBuffers.size()+4)) &&
+                   m_ring.Supports({IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_WRITE, IORING_OP_WRITE_FIXED, IORING_OP_CLOSE, IORING_OP_FSYNC});
+        if(m_bUring)
+        {
+            //registered buffers are pinned in memory, so if RLIMIT_MEMLOCK doesn't allow it use plain writes
+            m_bFixed = m_ring.RegisterBuffers(vIov);
+        }
+    }
+
+    AsyncWriter::~AsyncWriter()
+    {
+        Flush();
+        while(m_bUring && (m_bOpening || m_nInFlight != 0 || InKernel()))
+        {
+            Reap(true);
+        }
+        if(m_nFd != -1)
+        {
+            close(m_nFd);
+        }
+        if(m_bAbandoned)
+        {
+            //the kernel may still be reading some of the buffers
+            m_pMemory.release();
+        }
+    }
+
+    io_uring_sqe* AsyncWriter::GetSqe()
+    {
+        io_uring_sqe* pSqe = nullptr;
+        while(m_bUring && (pSqe = m_ring.GetSqe()) == nullptr)
+        {
+            Reap(true);
+        }
+        return pSqe;
+    }
+
+    bool AsyncWriter::Reserve(unsigned int nEntries)
+    {
+        //entries that are linked must be submitted together
+        while(m_bUring && m_ring.GetSpace() < nEntries)
+        {
+            Reap(true);
+        }
+        return m_bUring;
+    }
+
+    void AsyncWriter::Reap(bool bWait)
+    {
+        if(m_bUring == false)
+        {
+            return;
+        }
+        //EAGAIN and EBUSY mean the kernel is short of memory or the completion queue is full, so reaping is the way out
+        if(bWait && m_ring.Submit(true) < 0 && errno != EAGAIN && errno != EBUSY)
+        {
+            FallBack();
+            return;
+        }
+        m_ring.Reap([this](const io_uring_cqe& cqe){ Completed(cqe); });
+    }
+
+    void AsyncWriter::Completed(const io_uring_cqe& cqe)
+    {
+        //after FallBack an entry that was never submitted comes back as cancelled and is done synchronously instead
+        bool bCancelled = (m_bUring == false && cqe.res == -ECANCELED);
+        switch(cqe.user_data & kTypeMask)
+        {
+            case kOpen:
+                m_nOpenResult = cqe.res;
+                break;
+            case kStat:
+                m_bStatting = false;
+                if(m_nOpenResult == -ENOENT && m_bRetried == false && CreateDirectory())
+                {
+                    //the directory has been removed since the AsyncFile was created
+                    m_bRetried = true;
+                    if(m_bUring)
+                    {
+                        SubmitOpen();
+                    }
+                    else
+                    {
+                        OpenSync();
+                    }
+                }
+                else if(m_bUring == false && m_nOpenResult == -ECANCELED)
+                {
+                    OpenSync();
+                }
+                else if(m_nOpenResult >= 0 && cqe.res < 0)
+                {
+                    struct stat info;
+                    Opened(m_nOpenResult, fstat(m_nOpenResult, &info) == 0 ? static_cast<uint64_t>(info.st_size) : 0);
+                }
+                else
+                {
+                    Opened(m_nOpenResult, m_pStat->stx_size);
+                }
+                break;
+            case kClose:
+                --m_nClosing;
+                if(bCancelled)
+                {
+                    close(static_cast<int>(cqe.user_data & ~kTypeMask));
+                }
+                else if(cqe.res < 0)
+                {
+                    ++m_nErrors;
+                }
+                break;
+            case kCloseSync:
+                --m_nClosing;
+                if(bCancelled ? fdatasync(static_cast<int>(cqe.user_data & ~kTypeMask)) != 0 : cqe.res < 0)
+                {
+                    ++m_nErrors;
+                }
+                break;
+            case kSync:
+                m_bSyncing = false;
+                if(bCancelled ? fdatasync(m_nFd) != 0 : cqe.res < 0)
+                {
+                    ++m_nErrors;
+                }
+                break;
+            default:
+                {
+                    auto nBuffer = static_cast<int>(cqe.user_data);
+                    auto& aBuffer = m_vBuffers[nBuffer];
+                    aBuffer.bInKernel = false;
+                    if(cqe.res > 0 && aBuffer.nWritten+static_cast<uint32_t>(cqe.res) < aBuffer.nUsed)
+                    {
+                        //a short write has the rest of the buffer written after it
+                        aBuffer.nWritten += static_cast<uint32_t>(cqe.res);
+                        if(SubmitRemainder(nBuffer))
+                        {
+                            return;
+                        }
+                        WriteSync(aBuffer.nFd, aBuffer.pData+aBuffer.nWritten, aBuffer.nUsed-aBuffer.nWritten, aBuffer.nOffset+aBuffer.nWritten);
+                    }
+                    else if(bCancelled)
+                    {
+                        WriteSync(aBuffer.nFd, aBuffer.pData+aBuffer.nWritten, aBuffer.nUsed-aBuffer.nWritten, aBuffer.nOffset+aBuffer.nWritten);
+                    }
+                    else if(cqe.res <= 0)
+                    {
+                        ++m_nErrors;
+                    }
+                    WriteDone(nBuffer);
+                }
+                break;
+        }
+    }
+
+    io_uring_cqe AsyncWriter::Cancelled(uint64_t nUserData)
+    {
+        io_uring_cqe cqe{};
+        cqe.user_data = nUserData;
+        cqe.res = -ECANCELED;
+        return cqe;
+    }
+
+    bool AsyncWriter::InKernel() const
+    {
+        return m_bStatting || m_bSyncing || m_nClosing != 0 ||
+               std::any_of(m_vBuffers.begin(), m_vBuffers.end(), [](const auto& aBuffer){ return aBuffer.bInKernel; });
+    }
+
+    void AsyncWriter::FallBack()
+    {
+        //the ring can't be used any more so write synchronously from now on
+        std::cout << "Could not submit to io_uring\t" << std::strerror(errno) << std::endl;
+        m_bUring = false;
+
+        //entries the kernel has not taken yet never will be, so finish them here
+        m_ring.Withdraw([this](const io_uring_sqe& sqe)
+        {
+            Completed(Cancelled(sqe.user_data));
+        });
+
+        //the kernel may still be reading the buffers, and the open path, that it has taken so nothing is reused until they have completed
+        auto timeout = std::chrono::steady_clock::now()+kDrainTimeout;
+        while(InKernel() && std::chrono::steady_clock::now() < timeout)
+        {
+            if(m_ring.Reap([this](const io_uring_cqe& cqe){ Completed(cqe); }) == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        if(InKernel() == false)
+        {
+            return;
+        }
+
+        //the kernel has not finished with them, so write what they hold synchronously (the same bytes to the same place) and never touch their memory again
+        m_bAbandoned = true;
+        m_nClosing = 0;
+        if(m_bSyncing)
+        {
+            Completed(Cancelled(kSync));
+        }
+        if(m_bStatting)
+        {
+            m_pOpenPath = std::make_unique<std::string>(*m_pOpenPath.release());
+            m_pStat.release();
+            m_pStat = std::make_unique<struct statx>();
+            if(m_nOpenResult < 0)
+            {
+                m_nOpenResult = -ECANCELED;
+            }
+            Completed(Cancelled(kStat));
+        }
+        for(size_t i = 0; i < m_vBuffers.size(); i++)
+        {
+            if(m_vBuffers[i].bInKernel)
+            {
+                Completed(Cancelled(i));
+                m_vReplaced.emplace_back(new char[m_nBufferSize]);
+                m_vBuffers[i].pData = m_vReplaced.back().get();
+            }
+        }
+    }
+
+    int AsyncWriter::GetFreeBuffer()
+    {
+        while(m_vFree.empty())
+        {
+            Reap(true);
+        }
+        auto nBuffer = m_vFree.back();
+        m_vFree.pop_back();
+        return nBuffer;
+    }
+
+    void AsyncWriter::Release(int nBuffer)
+    {
+        m_vBuffers[nBuffer].nUsed = 0;
+        m_vBuffers[nBuffer].nWritten = 0;
+        m_vFree.push_back(nBuffer);
+    }
+
+    void AsyncWriter::Append(const char* pData, size_t nLength)
+    {
+        while(nLength != 0)
+        {
+            if(m_nCurrent == -1)
+            {
+                m_nCurrent = GetFreeBuffer();
+            }
+            auto& aBuffer = m_vBuffers[m_nCurrent];
+            auto nCopy = std::min(nLength, m_nBufferSize-aBuffer.nUsed);
+            std::memcpy(aBuffer.pData+aBuffer.nUsed, pData, nCopy);
+            aBuffer.nUsed += static_cast<uint32_t>(nCopy);
+            pData += nCopy;
+            nLength -= nCopy;
+
+            if(aBuffer.nUsed == m_nBufferSize)
+            {
+                Queue(m_nCurrent);
+                m_nCurrent = -1;
+            }
+        }
+    }
+
+    void AsyncWriter::Flush()
+    {
+        if(m_nCurrent != -1 && m_vBuffers[m_nCurrent].nUsed != 0)
+        {
+            Queue(m_nCurrent);
+            m_nCurrent = -1;
+        }
+        Reap(false);
+    }
+
+    bool AsyncWriter::Commit(bool bSync)
+    {
+        //Flush has submitted every buffer so wait for them to reach the kernel and, for kSync, for any rolled over file to be synced and closed
+        while(m_bUring && (m_bOpening || m_nInFlight != 0 || (bSync && m_nClosing != 0)))
+        {
+            Reap(true);
+        }
+        if(bSync && m_nFd != -1)
+        {
+            Sync();
+        }
+
+        //writes that failed, and messages written to the console because the file could not be opened, have not been committed
+        auto nErrors = m_nErrors.load();
+        auto bCommitted = (nErrors == m_nCommittedErrors && m_bUnfiled == false);
+        m_nCommittedErrors = nErrors;
+        m_bUnfiled = false;
+        return bCommitted;
+    }
+
+    void AsyncWriter::Sync()
+    {
+        auto pSqe = GetSqe();
+        if(pSqe == nullptr)
+        {
+            if(fdatasync(m_nFd) != 0)
+            {
+                ++m_nErrors;
+            }
+            return;
+        }
+        pSqe->opcode = IORING_OP_FSYNC;
+        pSqe->fd = m_nFd;
+        pSqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        pSqe->user_data = kSync;
+        m_bSyncing = true;
+        m_ring.Submit(false);
+        while(m_bSyncing)
+        {
+            Reap(true);
+        }
+    }
+
+    void AsyncWriter::Queue(int nBuffer)
+    {
+        if(m_bOpening)
+        {
+            m_dPending.push_back(nBuffer);
+        }
+        else
+        {
+            SubmitWrite(nBuffer);
+        }
+    }
+
+    void AsyncWriter::SubmitWrite(int nBuffer)
+    {
+        auto& aBuffer = m_vBuffers[nBuffer];
+        if(m_nFd == -1)
+        {
+            //the file could not be opened so write to the console as File does
+            WriteSync(STDOUT_FILENO, aBuffer.pData, aBuffer.nUsed, 0);
+            m_bUnfiled = true;
+            Release(nBuffer);
+        }
+        else if(m_bUring == false)
+        {
+            WriteSync(m_nFd, aBuffer.pData, aBuffer.nUsed, m_nOffset);
+            m_nOffset += aBuffer.nUsed;
+            Release(nBuffer);
+        }
+        else
+        {
+            aBuffer.nWritten = 0;
+            aBuffer.nOffset = m_nOffset;
+            aBuffer.nFd = m_nFd;
+            if(SubmitRemainder(nBuffer) == false)
+            {
+                SubmitWrite(nBuffer);
+                return;
+            }
+            m_nOffset += aBuffer.nUsed;
+            aBuffer.bInFlight = true;
+            ++m_nInFlight;
+        }
+    }
+
+    bool AsyncWriter::SubmitRemainder(int nBuffer)
+    {
+        auto pSqe = GetSqe();
+        if(pSqe == nullptr)
+        {
+            return false;
+        }
+        auto& aBuffer = m_vBuffers[nBuffer];
+        pSqe->opcode = m_bFixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        pSqe->fd = aBuffer.nFd;
+        pSqe->addr = reinterpret_cast<uint64_t>(aBuffer.pData+aBuffer.nWritten);
+        pSqe->len = aBuffer.nUsed-aBuffer.nWritten;
+        pSqe->off = aBuffer.nOffset+aBuffer.nWritten;
+        pSqe->buf_index = m_bFixed ? static_cast<uint16_t>(nBuffer) : 0;
+        pSqe->user_data = static_cast<uint64_t>(nBuffer);
+        aBuffer.bInKernel = true;
+        m_ring.Submit(false);
+        return true;
+    }
+
+    void AsyncWriter::WriteDone(int nBuffer)
+    {
+        auto& aBuffer = m_vBuffers[nBuffer];
+        aBuffer.bInFlight = false;
+        --m_nInFlight;
+        if(aBuffer.nFd != m_nFd)
+        {
+            //the last write to a rolled over file closes it
+            auto itClosing = std::find_if(m_vClosing.begin(), m_vClosing.end(), [&aBuffer](const auto& aClosing){ return aClosing.nFd == aBuffer.nFd; });
+            if(itClosing != m_vClosing.end() && --itClosing->nWrites == 0)
+            {
+                Close(itClosing->nFd);
+                m_vClosing.erase(itClosing);
+            }
+        }
+        Release(nBuffer);
+    }
+
+    void AsyncWriter::WriteSync(int nFd, const char* pData, size_t nLength, uint64_t nOffset)
+    {
+        while(nLength != 0)
+        {
+            auto nWritten = nFd == STDOUT_FILENO ? write(nFd, pData, nLength) : pwrite(nFd, pData, nLength, static_cast<off_t>(nOffset));
+            if(nWritten < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if(nWritten <= 0)
+            {
+                ++m_nErrors;
+                return;
+            }
+            pData += nWritten;
+            nOffset += static_cast<uint64_t>(nWritten);
+            nLength -= static_cast<size_t>(nWritten);
+        }
+    }
+
+    void AsyncWriter::Open(const std::string& sPath)
+    {
+        if(m_nCurrent != -1 && m_vBuffers[m_nCurrent].nUsed != 0)
+        {
+            Queue(m_nCurrent);
+            m_nCurrent = -1;
+        }
+
+        if(m_bOpening)
+        {
+            //the buffers already waiting belong to the file being opened, so this one is opened after it
+            m_dPending.push_back(kRollOver);
+            m_dPaths.push_back(sPath);
+        }
+        else
+        {
+            StartOpen(sPath);
+        }
+    }
+
+    void AsyncWriter::StartOpen(const std::string& sPath)
+    {
+        CloseFile();
+        *m_pOpenPath = sPath;
+        m_bRetried = false;
+        m_bOpening = true;
+        if(m_bUring)
+        {
+            SubmitOpen();
+        }
+        else
+        {
+            OpenSync();
+        }
+    }
+
+    void AsyncWriter::CloseFile()
+    {
+        if(m_nFd == -1)
+        {
+            return;
+        }
+        //writes to the file that are still in flight need its file descriptor, so the last of them closes it
+        auto nWrites = static_cast<size_t>(std::count_if(m_vBuffers.begin(), m_vBuffers.end(), [this](const auto& aBuffer){ return aBuffer.bInFlight && aBuffer.nFd == m_nFd; }));
+        if(nWrites == 0)
+        {
+            Close(m_nFd);
+        }
+        else
+        {
+            m_vClosing.push_back({m_nFd, nWrites});
+        }
+        m_nFd = -1;
+    }
+
+    void AsyncWriter::Close(int nFd)
+    {
+        //the file is synced before it is closed so that a kSync commit after a rollover covers the messages that went to it
+        if(Reserve(2) == false)
+        {
+            if(fdatasync(nFd) != 0)
+            {
+                ++m_nErrors;
+            }
+            close(nFd);
+            return;
+        }
+        auto pSqe = m_ring.GetSqe();
+        pSqe->opcode = IORING_OP_FSYNC;
+        pSqe->fd = nFd;
+        pSqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        pSqe->flags = IOSQE_IO_HARDLINK;
+        pSqe->user_data = kCloseSync | static_cast<uint32_t>(nFd);
+
+        pSqe = m_ring.GetSqe();
+        pSqe->opcode = IORING_OP_CLOSE;
+        pSqe->fd = nFd;
+        pSqe->user_data = kClose | static_cast<uint32_t>(nFd);
+        m_nClosing += 2;
+        m_ring.Submit(false);
+    }
+
+    void AsyncWriter::SubmitOpen()
+    {
+        if(Reserve(2) == false)
+        {
+            OpenSync();
+            return;
+        }
+        //the size of the file is needed for the offset of the first write, so the statx is linked to the open rather than calling fstat on this thread once it has opened
+        auto pSqe = m_ring.GetSqe();
+        pSqe->opcode = IORING_OP_OPENAT;
+        pSqe->fd = AT_FDCWD;
+        pSqe->addr = reinterpret_cast<uint64_t>(m_pOpenPath->c_str());
+        pSqe->len = 0666;
+        pSqe->open_flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+        pSqe->flags = IOSQE_IO_LINK;
+        pSqe->user_data = kOpen;
+
+        pSqe = m_ring.GetSqe();
+        pSqe->opcode = IORING_OP_STATX;
+        pSqe->fd = AT_FDCWD;
+        pSqe->addr = reinterpret_cast<uint64_t>(m_pOpenPath->c_str());
+        pSqe->len = STATX_SIZE;
+        pSqe->off = reinterpret_cast<uint64_t>(m_pStat.get());
+        pSqe->user_data = kStat;
+
+        m_nOpenResult = -ECANCELED;
+        m_bStatting = true;
+        m_ring.Submit(false);
+    }
+
+    void AsyncWriter::OpenSync()
+    {
+        auto nFd = open(m_pOpenPath->c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0666);
+        if(nFd < 0 && errno == ENOENT && m_bRetried == false && CreateDirectory())
+        {
+            m_bRetried = true;
+            nFd = open(m_pOpenPath->c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0666);
+        }
+        if(nFd < 0)
+        {
+            Opened(-errno, 0);
+            return;
+        }
+        struct stat info;
+        Opened(nFd, fstat(nFd, &info) == 0 ? static_cast<uint64_t>(info.st_size) : 0);
+    }
+
+    bool AsyncWriter::CreateDirectory()
+    {
+        auto directory = std::filesystem::path(*m_pOpenPath).parent_path();
+        if(std::error_code ec; std::filesystem::create_directories(directory, ec) == false && ec.value() != 0)
+        {
+            std::cout << "Could not create log directory " << directory << "\t" << ec.message() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void AsyncWriter::Opened(int nResult, uint64_t nSize)
+    {
+        m_bOpening = false;
+        if(nResult >= 0)
+        {
+            m_nFd = nResult;
+            m_nOffset = nSize;
+        }
+        else
+        {
+            m_nFd = -1;
+            std::cout << "Could not open log file " << *m_pOpenPath << "\t" << std::strerror(-nResult) << std::endl;
+        }
+
+        while(m_dPending.empty() == false)
+        {
+            auto nBuffer = m_dPending.front();
+            m_dPending.pop_front();
+            if(nBuffer == kRollOver)
+            {
+                //the rest of the buffers are for the next file
+                auto sPath = std::move(m_dPaths.front());
+                m_dPaths.pop_front();
+                StartOpen(sPath);
+                return;
+            }
+            SubmitWrite(nBuffer);
+        }
+    }
+}
+
+
+AsyncFile::AsyncFile(const std::filesystem::path& rootPath, int nTimestamp, TS resolution, bool bLocalTime, size_t nBuffers, size_t nBufferSize) : Output(nTimestamp, resolution),
+m_rootPath(rootPath),
+m_bLocalTime(bLocalTime),
+m_pWriter(std::make_unique<detail::AsyncWriter>(nBuffers, nBufferSize))
+{
+    //created here rather than on the Manager thread. If it is removed later the writer creates it again when the next file fails to open
+    if(std::error_code ec; std::filesystem::create_directories(m_rootPath, ec) == false && ec.value() != 0)
+    {
+        std::cout << "Could not create log directory " << m_rootPath << "\t" << ec.message() << std::endl;
+    }
+}
+
+AsyncFile::~AsyncFile() = default;
+
+bool AsyncFile::IsUsingIoUring() const
+{
+    return m_pWriter->IsUsingIoUring();
+}
+
+uint64_t AsyncFile::GetErrors() const
+{
+    return m_pWriter->GetErrors();
+}
+
+void AsyncFile::DoOutputMessage(Level, const std::string&, const std::string&)
+{
+    auto in_time_t = std::chrono::system_clock::to_time_t(GetTime());
+
+    tm fileTime;
+    if(m_bLocalTime)
+    {
+        localtime_r(&in_time_t, &fileTime);
+    }
+    else
+    {
+        gmtime_r(&in_time_t, &fileTime);
+    }
+    char sFileName[32];
+    std::strftime(sFileName, sizeof(sFileName), "/%Y-%m-%dT%H", &fileTime);
+
+    if(m_sCurrentFile != sFileName)
+    {
+        m_sCurrentFile = sFileName;
+        m_pWriter->Open(m_rootPath.string()+m_sCurrentFile+".log");
+    }
+
+    const auto& sLine = GetLine();
+    m_pWriter->Append(sLine.data(), sLine.size());
+}
+
+void AsyncFile::Flush()
+{
+    m_pWriter->Flush();
+}
+
+bool AsyncFile::Commit(Durability durability)
+{
+    return m_pWriter->Commit(durability == Durability::kSync);
+}
+
+}
+#endif
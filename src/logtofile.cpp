@@ -6,8 +6,14 @@
 #include <string>
 #include <sys/stat.h> // stat
 #include <errno.h>    // errno, ENOENT, EEXIST
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include <chrono>
+#include <cstring>
+#include <ctime>
 #include <iomanip>
 #include <algorithm>
 
@@ -21,12 +27,39 @@ m_bLocalTime(bLocalTime)
 {
 }
 
-void File::OpenFile(const std::string& sFileName)
+File::~File()
+{
+    WriteIndexBlock();
+    CloseSyncFd();
+}
+
+void File::SetIndexInterval(std::chrono::seconds interval)
+{
+    m_indexInterval = std::max(interval, std::chrono::seconds(0));
+}
+
+void File::OpenFile(const std::string& sFileName, time_t hour)
 {
     if(m_ofLog.is_open())
     {
+        //messages in the current batch that went to the old file are committed along with the rest of the batch, so the old file is synced now if any might need it
+        for(auto level : {Level::kTrace, Level::kDebug, Level::kInfo, Level::kWarning, Level::kError, Level::kCritical})
+        {
+            if(GetDurability(level) == Durability::kSync)
+            {
+                m_ofLog.flush();
+                m_bCommitFailed |= (m_ofLog.good() == false || Sync() == false);
+                break;
+            }
+        }
         m_ofLog.close();
     }
+    WriteIndexBlock();
+    if(m_ofIndex.is_open())
+    {
+        m_ofIndex.close();
+    }
+    CloseSyncFd();
 
 
     m_sCurrentFile = sFileName;
@@ -41,49 +74,109 @@ void File::OpenFile(const std::string& sFileName)
     {
         m_bOk = true;
         m_ofLog.open(sPath, std::fstream::app);
+
+        std::error_code ecSize;
+        auto nSize = std::filesystem::file_size(sPath, ecSize);
+        m_nOffset = ecSize ? 0 : nSize;
+
+        if(m_indexInterval.count() > 0)
+        {
+            OpenIndex(sFileName, hour);
+        }
+    }
+}
+
+void File::OpenIndex(const std::string& sFileName, time_t hour)
+{
+    auto sPath = m_rootPath.string() + sFileName+".idx";
+
+    std::error_code ec;
+    auto nSize = std::filesystem::file_size(sPath, ec);
+
+    m_ofIndex.open(sPath, std::fstream::app | std::fstream::binary);
+    if(m_ofIndex.is_open() && (ec || nSize == 0))
+    {
+        IndexHeader header{};
+        std::memcpy(header.aMagic, IndexHeader::kMagic, sizeof(header.aMagic));
+        header.nHour = hour;
+        m_ofIndex.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        m_ofIndex.flush();
+    }
+}
+
+void File::WriteIndexBlock()
+{
+    if(m_bBlockOpen && m_ofIndex.is_open())
+    {
+        m_ofIndex.write(reinterpret_cast<const char*>(&m_block), sizeof(m_block));
+        m_ofIndex.flush();
     }
+    m_bBlockOpen = false;
 }
 
 void File::DoOutputMessage(Level level, const std::string&  sLog, const std::string& sPrefix)
 {
-    if(level >= m_level)// && m_bOk)
+    auto in_time_t = std::chrono::system_clock::to_time_t(GetTime());
+
+    tm fileTime;
+    if(m_bLocalTime)
     {
-        auto now = std::chrono::system_clock::now();
-        auto in_time_t = std::chrono::system_clock::to_time_t(now);
+        localtime_r(&in_time_t, &fileTime);
+    }
+    else
+    {
+        gmtime_r(&in_time_t, &fileTime);
+    }
+    std::stringstream ssFileName;
+    ssFileName << std::put_time(&fileTime, "/%Y-%m-%dT%H");
 
-        std::stringstream ssFileName;
-        if(m_bLocalTime)
-        {
-            ssFileName << std::put_time(localtime(&in_time_t), "/%Y-%m-%dT%H");
-        }
-        else
-        {
-            ssFileName << std::put_time(gmtime(&in_time_t), "/%Y-%m-%dT%H");
-        }
+    if(m_ofLog.is_open() == false || ssFileName.str() != m_sCurrentFile)
+    {
+        OpenFile(ssFileName.str(), in_time_t - fileTime.tm_min*60 - fileTime.tm_sec);
+    }
 
-        if(m_ofLog.is_open() == false || ssFileName.str() != m_sCurrentFile)
-        {
-            OpenFile(ssFileName.str());
-        }
+    if(m_ofLog.is_open())
+    {
+        const auto& sLine = GetLine();
+        m_ofLog << sLine;
+        m_ofLog.flush();
 
-        if(m_ofLog.is_open())
+        if(m_ofIndex.is_open())
         {
-            m_ofLog << Timestamp().str();
-            m_ofLog << Stream::STR_LEVEL[static_cast<int>(level)] << "\t" << "[" << sPrefix << "]\t" << sLog;
-            m_ofLog.flush();
-        }
-        else
-        {
-            if(m_bLocalTime)
+            auto nInterval = static_cast<time_t>(m_indexInterval.count());
+            if(m_bBlockOpen && in_time_t >= m_block.nStart+nInterval)
             {
-                std::cout << Stream::STR_LEVEL[static_cast<int>(level)] << "\t" << "[" << sPrefix << "]\t" << sLog;
+                WriteIndexBlock();
             }
-            else
+            if(m_bBlockOpen == false)
             {
-                std::cout << Stream::STR_LEVEL[static_cast<int>(level)] << "\t" << "[" << sPrefix << "]\t" << sLog;
+                m_block = IndexBlock{};
+                m_block.nStart = in_time_t - in_time_t%nInterval;
+                m_block.nOffset = m_nOffset;
+                m_bBlockOpen = true;
             }
-            std::cout.flush();
+            m_block.nEnd = in_time_t+1;
+            m_block.nLength += sLine.size();
+            ++m_block.aCount[static_cast<int>(level)];
         }
+        m_nOffset += sLine.size();
+    }
+    else
+    {
+        m_bCommitFailed = true;
+        if(m_bLocalTime)
+        {
+            std::cout << Stream::STR_LEVEL[static_cast<int>(level)] << "\t" << "[" << sPrefix << "]\t";
+            WriteContext(std::cout);
+            std::cout << sLog;
+        }
+        else
+        {
+            std::cout << Stream::STR_LEVEL[static_cast<int>(level)] << "\t" << "[" << sPrefix << "]\t";
+            WriteContext(std::cout);
+            std::cout << sLog;
+        }
+        std::cout.flush();
     }
 }
 
@@ -99,6 +192,48 @@ void File::Flush()
     }   
 }
 
+bool File::Commit(Durability durability)
+{
+    //Flush has already handed the messages to the kernel, unless they could not be written to the file
+    auto bCommitted = m_bCommitFailed == false && m_ofLog.is_open() && m_ofLog.good();
+    m_bCommitFailed = false;
+    m_ofLog.clear();
+#ifndef _WIN32
+    if(bCommitted && durability == Durability::kSync)
+    {
+        bCommitted = Sync();
+    }
+#endif
+    return bCommitted;
+}
+
+bool File::Sync()
+{
+#ifndef _WIN32
+    if(m_nSyncFd == -1)
+    {
+        m_nSyncFd = open((m_rootPath.string()+m_sCurrentFile+".log").c_str(), O_WRONLY | O_CLOEXEC);
+    }
+    if(m_nSyncFd == -1 || fdatasync(m_nSyncFd) != 0)
+    {
+        std::cout << "Could not sync log file " << m_rootPath.string() << m_sCurrentFile << ".log\t" << std::strerror(errno) << std::endl;
+        return false;
+    }
+#endif
+    return true;
+}
+
+void File::CloseSyncFd()
+{
+#ifndef _WIN32
+    if(m_nSyncFd != -1)
+    {
+        close(m_nSyncFd);
+        m_nSyncFd = -1;
+    }
+#endif
+}
+
 #else
 bool isDirExist(const std::string& path)
 {
@@ -212,44 +347,43 @@ void File::OpenFile(const std::string& sFilePath, const std::string& sFileName)
 
 void File::DoOutputMessage(Level level, const std::string&  sLog, const std::string& sPrefix)
 {
-    if(level >= m_level)// && m_bOk)
-    {
-        auto now = std::chrono::system_clock::now();
-        auto in_time_t = std::chrono::system_clock::to_time_t(now);
+    auto in_time_t = std::chrono::system_clock::to_time_t(GetTime());
 
-        std::stringstream ssFileName;
-        if(m_bLocalTime)
-        {
-            ssFileName << std::put_time(localtime(&in_time_t), "/%Y-%m-%dT%H");
-        }
-        else
-        {
-            ssFileName << std::put_time(gmtime(&in_time_t), "/%Y-%m-%dT%H");
-        }
+    std::stringstream ssFileName;
+    if(m_bLocalTime)
+    {
+        ssFileName << std::put_time(localtime(&in_time_t), "/%Y-%m-%dT%H");
+    }
+    else
+    {
+        ssFileName << std::put_time(gmtime(&in_time_t), "/%Y-%m-%dT%H");
+    }
 
-        if(m_ofLog.is_open() == false || ssFileName.str() != m_sFileName)
-        {
-            OpenFile(m_sRootPath, ssFileName.str());
-        }
+    if(m_ofLog.is_open() == false || ssFileName.str() != m_sFileName)
+    {
+        OpenFile(m_sRootPath, ssFileName.str());
+    }
 
-        if(m_ofLog.is_open())
+    if(m_ofLog.is_open())
+    {
+        m_ofLog << GetLine();
+        m_ofLog.flush();
+    }
+    else
+    {
+        if(m_bLocalTime)
         {
-            m_ofLog << Timestamp().str();
-            m_ofLog << Stream::STR_LEVEL[static_cast<int>(level)] << "\t" << "[" << sPrefix << "]\t" << sLog;
-            m_ofLog.flush();
+            std::cout << Stream::STR_LEVEL[static_cast<int>(level)] << "\t" << "[" << sPrefix << "]\t";
+            WriteContext(std::cout);
+            std::cout << sLog;
         }
         else
         {
-            if(m_bLocalTime)
-            {
-                std::cout << Stream::STR_LEVEL[static_cast<int>(level)] << "\t" << "[" << sPrefix << "]\t" << sLog;
-            }
-            else
-            {
-                std::cout << Stream::STR_LEVEL[static_cast<int>(level)] << "\t" << "[" << sPrefix << "]\t" << sLog;
-            }
-            std::cout.flush();
+            std::cout << Stream::STR_LEVEL[static_cast<int>(level)] << "\t" << "[" << sPrefix << "]\t";
+            WriteContext(std::cout);
+            std::cout << sLog;
         }
+        std::cout.flush();
     }
 }
 
@@ -0,0 +1,197 @@
+#include "logtoshm.h"
+
+#ifdef __linux__
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logshm.h"
+
+namespace pml::log
+{
+
+static std::atomic<uint32_t> g_nSegment{0};     ///< so that a process can have more than one SharedMemory output
+
+static size_t RoundUpPowerOf2(size_t nValue)
+{
+    size_t nPower = 4096;
+    while(nPower < nValue)
+    {
+        nPower <<= 1;
+    }
+    return nPower;
+}
+
+static constexpr uint64_t RoundUp8(uint64_t nValue)
+{
+    return (nValue+7) & ~uint64_t(7);
+}
+
+SharedMemory::SharedMemory(const std::string& sChannel, size_t nCapacity) : Output(kTsNone),
+m_sName("/pml_log."+sChannel+"."+std::to_string(getpid())+"."+std::to_string(g_nSegment++)),
+m_nCapacity(RoundUpPowerOf2(nCapacity))
+{
+    auto nFd = shm_open(m_sName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if(nFd == -1 && errno == EEXIST)
+    {
+        //left behind by an earlier process that had the same pid
+        shm_unlink(m_sName.c_str());
+        nFd = shm_open(m_sName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+    if(nFd == -1)
+    {
+        std::cout << "Could not create shared memory " << m_sName << "\t" << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    auto nSize = ShmHeader::kSize+m_nCapacity;
+    void* pSegment = MAP_FAILED;
+    if(ftruncate(nFd, static_cast<off_t>(nSize)) == 0)
+    {
+        pSegment = mmap(nullptr, nSize, PROT_READ | PROT_WRITE, MAP_SHARED, nFd, 0);
+    }
+    close(nFd);
+
+    if(pSegment == MAP_FAILED)
+    {
+        std::cout << "Could not map shared memory " << m_sName << "\t" << std::strerror(errno) << std::endl;
+        shm_unlink(m_sName.c_str());
+        return;
+    }
+
+    m_pHeader = new(pSegment) ShmHeader{};
+    m_pHeader->nCapacity = m_nCapacity;
+    m_pHeader->nPid = getpid();
+    m_pRing = static_cast<char*>(pSegment)+ShmHeader::kSize;
+    m_pHeader->nMagic.store(ShmHeader::kMagic, std::memory_order_release);
+}
+
+SharedMemory::~SharedMemory()
+{
+    if(m_pHeader)
+    {
+        Flush();
+        m_pHeader->nClosed.store(1, std::memory_order_release);
+
+        //leave the segment for the collector to remove unless it has already read everything
+        if(m_pHeader->nTail.load(std::memory_order_acquire) == m_nHead)
+        {
+            shm_unlink(m_sName.c_str());
+        }
+        munmap(m_pHeader, ShmHeader::kSize+m_nCapacity);
+    }
+}
+
+uint64_t SharedMemory::GetDropped() const
+{
+    return m_pHeader ? m_pHeader->nDropped.load(std::memory_order_relaxed) : m_nDropped;
+}
+
+bool SharedMemory::IsCollectorAlive(std::chrono::milliseconds timeout) const
+{
+    if(m_pHeader == nullptr)
+    {
+        return false;
+    }
+    auto nSeen = m_pHeader->nCollectorSeen.load(std::memory_order_relaxed);
+    auto nNow = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    return nSeen != 0 && nNow-nSeen < std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+}
+
+void SharedMemory::Write(const void* pData, size_t nLength)
+{
+    //the caller has made sure the record does not run past the end of the ring
+    std::memcpy(m_pRing+(m_nHead & (m_nCapacity-1)), pData, nLength);
+    m_nHead += nLength;
+}
+
+void SharedMemory::DoOutputMessage(Level level, const std::string&  sLog, const std::string& sPrefix)
+{
+    if(m_pHeader == nullptr)
+    {
+        ++m_nDropped;
+        return;
+    }
+
+    auto pContext = GetContext();
+    uint64_t nContextLength = 0;
+    if(pContext)
+    {
+        for(const auto& entry : pContext->GetEntries())
+        {
+            nContextLength += 2*sizeof(uint16_t)+std::min<size_t>(entry.first.size(), std::numeric_limits<uint16_t>::max())
+                                                +std::min<size_t>(entry.second.size(), std::numeric_limits<uint16_t>::max());
+        }
+    }
+
+    ShmRecord record{};
+    record.nPrefixLength = static_cast<uint16_t>(std::min<size_t>(sPrefix.size(), std::numeric_limits<uint16_t>::max()));
+    record.nContextLength = static_cast<uint32_t>(nContextLength);
+
+    //no record may take more than a quarter of the ring so cut long messages short
+    auto nMaxRecord = m_nCapacity/4;
+    auto nFixed = sizeof(ShmRecord)+record.nPrefixLength+nContextLength;
+    if(nFixed+8 > nMaxRecord)
+    {
+        m_pHeader->nDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    record.nMessageLength = static_cast<uint32_t>(std::min<uint64_t>(sLog.size(), nMaxRecord-nFixed-8));
+    record.nLength = static_cast<uint32_t>(RoundUp8(nFixed+record.nMessageLength));
+    record.nLevel = static_cast<uint8_t>(level);
+    record.nTime = std::chrono::duration_cast<std::chrono::nanoseconds>(GetTime().time_since_epoch()).count();
+
+    auto nToEnd = m_nCapacity-(m_nHead & (m_nCapacity-1));
+    auto nNeeded = record.nLength+(nToEnd < record.nLength ? nToEnd : 0);
+    if(m_nHead+nNeeded-m_pHeader->nTail.load(std::memory_order_acquire) > m_nCapacity)
+    {
+        m_pHeader->nDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if(nToEnd < record.nLength)
+    {
+        //records are a multiple of 8 bytes so there is always room for the marker
+        auto nPadding = ShmRecord::kPadding;
+        std::memcpy(m_pRing+(m_nHead & (m_nCapacity-1)), &nPadding, sizeof(nPadding));
+        m_nHead += nToEnd;
+    }
+
+    auto nStart = m_nHead;
+    Write(&record, sizeof(record));
+    Write(sPrefix.data(), record.nPrefixLength);
+    if(pContext)
+    {
+        for(const auto& entry : pContext->GetEntries())
+        {
+            for(const auto* pString : {&entry.first, &entry.second})
+            {
+                auto nLength = static_cast<uint16_t>(std::min<size_t>(pString->size(), std::numeric_limits<uint16_t>::max()));
+                Write(&nLength, sizeof(nLength));
+                Write(pString->data(), nLength);
+            }
+        }
+    }
+    Write(sLog.data(), record.nMessageLength);
+    m_nHead = nStart+record.nLength;
+}
+
+void SharedMemory::Flush()
+{
+    if(m_pHeader)
+    {
+        m_pHeader->nHead.store(m_nHead, std::memory_order_release);
+    }
+}
+
+}
+#endif
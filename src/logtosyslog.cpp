@@ -0,0 +1,326 @@
+#include "logtosyslog.h"
+
+#ifdef __linux__
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace pml::log
+{
+
+const std::string Syslog::kSyslogSocket = "/dev/log";
+const std::string Syslog::kJournaldSocket = "/run/systemd/journal/socket";
+
+static std::string_view TrimNewLines(const std::string& sLog)
+{
+    std::string_view sv(sLog);
+    while(sv.empty() == false && (sv.back() == '\n' || sv.back() == '\r'))
+    {
+        sv.remove_suffix(1);
+    }
+    return sv;
+}
+
+Syslog::Syslog(Protocol protocol, const std::string& sIdentifier, int nFacility, const std::string& sSocketPath) : Output(kTsNone),
+m_protocol(protocol),
+m_sIdentifier(sIdentifier.empty() ? std::string(program_invocation_short_name) : sIdentifier),
+m_nFacility(nFacility),
+m_sSocketPath(sSocketPath.empty() ? (protocol == Protocol::kSyslog ? kSyslogSocket : kJournaldSocket) : sSocketPath),
+m_sPid(std::to_string(getpid()))
+{
+    char sHost[256] = {0};
+    if(gethostname(sHost, sizeof(sHost)-1) == 0)
+    {
+        m_sHostname = sHost;
+    }
+    else
+    {
+        m_sHostname = "-";
+    }
+    Connect();
+}
+
+Syslog::~Syslog()
+{
+    Disconnect();
+}
+
+int Syslog::GetSeverity(Level level)
+{
+    switch(level)
+    {
+        case Level::kTrace:
+        case Level::kDebug:
+            return 7;   //debug
+        case Level::kInfo:
+            return 6;   //informational
+        case Level::kWarning:
+            return 4;   //warning
+        case Level::kError:
+            return 3;   //error
+        case Level::kCritical:
+            return 2;   //critical
+        default:
+            return 6;
+    }
+}
+
+bool Syslog::Connect()
+{
+    m_tpRetry = std::chrono::steady_clock::now()+kRetryInterval;
+
+    m_nSocket = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(m_nSocket < 0)
+    {
+        return false;
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, m_sSocketPath.c_str(), sizeof(address.sun_path)-1);
+    if(connect(m_nSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        Disconnect();
+        return false;
+    }
+    return true;
+}
+
+void Syslog::Disconnect()
+{
+    if(m_nSocket >= 0)
+    {
+        close(m_nSocket);
+        m_nSocket = -1;
+    }
+}
+
+std::string& Syslog::NextDatagram()
+{
+    if(m_nPending == m_vDatagrams.size())
+    {
+        m_vDatagrams.emplace_back();
+    }
+    auto& sDatagram = m_vDatagrams[m_nPending++];
+    sDatagram.clear();
+    return sDatagram;
+}
+
+void Syslog::DoOutputMessage(Level level, const std::string&  sLog, const std::string& sPrefix)
+{
+    if(m_protocol == Protocol::kSyslog)
+    {
+        AddSyslogDatagram(level, sLog, sPrefix);
+    }
+    else
+    {
+        AddJournaldDatagram(level, sLog, sPrefix);
+    }
+}
+
+void Syslog::RenderContext()
+{
+    auto pContext = GetContext();
+    if(pContext == nullptr || pContext->GetVersion() == m_nContextVersion)
+    {
+        return;
+    }
+    m_nContextVersion = pContext->GetVersion();
+    m_sContext.clear();
+
+    if(m_protocol == Protocol::kSyslog)
+    {
+        //a single SD-ELEMENT. Names may not contain '=', ' ', ']' or '"' and values must escape '"', '\' and ']'
+        m_sContext = "[pml@32473";
+        for(const auto& [sKey, sValue] : pContext->GetEntries())
+        {
+            m_sContext += " ";
+            for(auto c : sKey.substr(0, 32))
+            {
+                m_sContext += (c <= ' ' || c > '~' || c == '=' || c == ']' || c == '"') ? '_' : c;
+            }
+            m_sContext += "=\"";
+            for(auto c : sValue)
+            {
+                if(c == '"' || c == '\\' || c == ']')
+                {
+                    m_sContext += '\\';
+                }
+                m_sContext += c;
+            }
+            m_sContext += "\"";
+        }
+        m_sContext += "]";
+    }
+    else
+    {
+        //journald field names are upper case letters, digits and underscores and must not start with an underscore
+        for(const auto& [sKey, sValue] : pContext->GetEntries())
+        {
+            m_sContext += "PML_LOG_CTX_";
+            for(auto c : sKey)
+            {
+                m_sContext += std::isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(std::toupper(static_cast<unsigned char>(c))) : '_';
+            }
+            if(sValue.find('\n') == std::string::npos)
+            {
+                m_sContext += "="+sValue+"\n";
+            }
+            else
+            {
+                m_sContext += "\n";
+                uint64_t nLength = sValue.size();
+                for(int i = 0; i < 8; i++)
+                {
+                    m_sContext += static_cast<char>((nLength >> (i*8)) & 0xFF);
+                }
+                m_sContext += sValue+"\n";
+            }
+        }
+    }
+}
+
+void Syslog::AddSyslogDatagram(Level level, const std::string&  sLog, const std::string& sPrefix)
+{
+    auto now = GetTime();
+    auto in_time_t = std::chrono::system_clock::to_time_t(now);
+    tm utc_time;
+    gmtime_r(&in_time_t, &utc_time);
+
+    char sTime[32];
+    auto nLength = strftime(sTime, sizeof(sTime), "%Y-%m-%dT%H:%M:%S", &utc_time);
+    snprintf(sTime+nLength, sizeof(sTime)-nLength, ".%06dZ", static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count()%1000000));
+
+    // <PRI>VERSION TIMESTAMP HOSTNAME APP-NAME PROCID MSGID STRUCTURED-DATA MSG
+    auto& sDatagram = NextDatagram();
+    sDatagram += "<"+std::to_string(m_nFacility*8+GetSeverity(level))+">1 ";
+    sDatagram += sTime;
+    sDatagram += " "+m_sHostname+" "+m_sIdentifier+" "+m_sPid+" ";
+    if(sPrefix.empty())
+    {
+        sDatagram += "-";
+    }
+    else
+    {
+        //MSGID is at most 32 printable US-ASCII characters, so no spaces
+        for(auto c : std::string_view(sPrefix).substr(0, 32))
+        {
+            sDatagram += (c <= ' ' || c > '~') ? '_' : c;
+        }
+    }
+    if(GetContext())
+    {
+        RenderContext();
+        sDatagram += " "+m_sContext+" ";
+    }
+    else
+    {
+        sDatagram += " - ";
+    }
+    sDatagram += TrimNewLines(sLog);
+}
+
+void Syslog::AddJournaldDatagram(Level level, const std::string&  sLog, const std::string& sPrefix)
+{
+    auto& sDatagram = NextDatagram();
+    sDatagram += "PRIORITY="+std::to_string(GetSeverity(level))+"\n";
+    sDatagram += "SYSLOG_FACILITY="+std::to_string(m_nFacility)+"\n";
+    sDatagram += "SYSLOG_IDENTIFIER="+m_sIdentifier+"\n";
+    sDatagram += "PML_LOG_LEVEL="+Stream::STR_LEVEL[static_cast<int>(level)]+"\n";
+    if(sPrefix.empty() == false)
+    {
+        sDatagram += "PML_LOG_PREFIX="+sPrefix+"\n";
+    }
+    if(GetContext())
+    {
+        RenderContext();
+        sDatagram += m_sContext;
+    }
+
+    auto sMessage = TrimNewLines(sLog);
+    if(sMessage.find('\n') == std::string_view::npos)
+    {
+        sDatagram += "MESSAGE=";
+        sDatagram += sMessage;
+        sDatagram += "\n";
+    }
+    else
+    {
+        //multi-line values are sent as the field name, a little-endian 64 bit length and then the data
+        sDatagram += "MESSAGE\n";
+        uint64_t nLength = sMessage.size();
+        for(int i = 0; i < 8; i++)
+        {
+            sDatagram += static_cast<char>((nLength >> (i*8)) & 0xFF);
+        }
+        sDatagram += sMessage;
+        sDatagram += "\n";
+    }
+}
+
+void Syslog::Flush()
+{
+    if(m_nPending == 0)
+    {
+        return;
+    }
+
+    if(m_nSocket < 0 && (std::chrono::steady_clock::now() < m_tpRetry || Connect() == false))
+    {
+        m_nDropped.fetch_add(m_nPending, std::memory_order_relaxed);
+        m_nPending = 0;
+        return;
+    }
+
+    m_vIov.resize(m_nPending);
+    m_vMsg.resize(m_nPending);
+    for(size_t i = 0; i < m_nPending; i++)
+    {
+        m_vIov[i].iov_base = m_vDatagrams[i].data();
+        m_vIov[i].iov_len = m_vDatagrams[i].size();
+        m_vMsg[i] = mmsghdr{};
+        m_vMsg[i].msg_hdr.msg_iov = &m_vIov[i];
+        m_vMsg[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    size_t nSent = 0;
+    while(nSent < m_nPending)
+    {
+        auto nResult = sendmmsg(m_nSocket, m_vMsg.data()+nSent, static_cast<unsigned int>(m_nPending-nSent), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if(nResult > 0)
+        {
+            nSent += static_cast<size_t>(nResult);
+        }
+        else if(nResult < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if(nResult < 0 && errno == EMSGSIZE)
+        {
+            //this datagram is too big for the socket. skip it and carry on with the rest
+            m_nDropped.fetch_add(1, std::memory_order_relaxed);
+            ++nSent;
+        }
+        else
+        {
+            if(nResult < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS)
+            {
+                //the daemon has gone away. try to reconnect later
+                Disconnect();
+            }
+            m_nDropped.fetch_add(m_nPending-nSent, std::memory_order_relaxed);
+            break;
+        }
+    }
+    m_nPending = 0;
+}
+
+}
+#endif
@@ -1,17 +1,156 @@
 #include "wx/wxlogoutput.h"
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <wx/timer.h>
 
 wxDEFINE_EVENT(wxEVT_LOG, wxCommandEvent);
+wxDEFINE_EVENT(wxEVT_LOG_BATCH, wxLogBatchEvent);
+
+
+/** @brief the batching state that is shared by the Manager thread, which adds the messages, and the GUI thread, which handles the events
+**/
+struct wxLogBatchState : std::enable_shared_from_this<wxLogBatchState>
+{
+    explicit wxLogBatchState(wxEvtHandler* pH) : pHandler(pH){}
+
+    void Post();
+    void Handled();
+    void Compact();
+
+    std::mutex mutex;           ///< protects everything below
+    wxEvtHandler* pHandler;
+    std::chrono::milliseconds interval{0};
+    size_t nMaxPending = 10000;
+    std::deque<wxLogRecord> dPending;
+    std::string sPending;       ///< the text of the pending messages. Dropped messages leave their text at the front until it is compacted
+    size_t nDropped = 0;
+    bool bInFlight = false;     ///< an event has been posted and not yet handled
+    bool bWaiting = false;      ///< the timer has been asked to post once the interval has passed
+    std::chrono::steady_clock::time_point tpLastPost;
+    std::unique_ptr<wxTimer> pTimer;    ///< created, started and destroyed on the GUI thread
+};
+
+class wxLogBatchTimer : public wxTimer
+{
+    public:
+        explicit wxLogBatchTimer(wxLogBatchState& state) : m_state(state){}
+
+        void Notify() override
+        {
+            std::lock_guard<std::mutex> lg(m_state.mutex);
+            m_state.bWaiting = false;
+            m_state.Post();
+        }
+
+    private:
+        wxLogBatchState& m_state;
+};
+
+void wxLogBatchState::Post()
+{
+    //called with the mutex held
+    if(bInFlight || bWaiting || dPending.empty())
+    {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if(now-tpLastPost < interval)
+    {
+        //a wxTimer can only be used on the GUI thread
+        bWaiting = true;
+        auto nWait = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(tpLastPost+interval-now).count())+1;
+        pHandler->CallAfter([pState = shared_from_this(), nWait]
+        {
+            if(pState->pTimer == nullptr)
+            {
+                pState->pTimer = std::make_unique<wxLogBatchTimer>(*pState);
+            }
+            pState->pTimer->Start(nWait, wxTIMER_ONE_SHOT);
+        });
+        return;
+    }
+    tpLastPost = now;
+    bInFlight = true;
+
+    auto pBatch = std::make_shared<wxLogBatch>();
+    Compact();
+    pBatch->vRecords.assign(dPending.begin(), dPending.end());
+    pBatch->sText = std::move(sPending);
+    dPending.clear();
+    sPending.clear();
+
+    std::shared_ptr<void> pHandled(nullptr, [pState = shared_from_this()](void*){ pState->Handled(); });
+    wxQueueEvent(pHandler, new wxLogBatchEvent(std::move(pBatch), nDropped, std::move(pHandled)));
+    nDropped = 0;
+}
+
+void wxLogBatchState::Compact()
+{
+    //called with the mutex held
+    auto nStart = dPending.empty() ? sPending.size() : dPending.front().nOffset;
+    if(nStart != 0)
+    {
+        sPending.erase(0, nStart);
+        for(auto& record : dPending)
+        {
+            record.nOffset -= static_cast<uint32_t>(nStart);
+        }
+    }
+}
+
+void wxLogBatchState::Handled()
+{
+    std::lock_guard<std::mutex> lg(mutex);
+    bInFlight = false;
+    Post();
+}
+
+
+wxLogBatchEvent::wxLogBatchEvent(std::shared_ptr<const wxLogBatch> pBatch, size_t nDropped, std::shared_ptr<void> pHandled) : wxEvent(0, wxEVT_LOG_BATCH),
+m_pBatch(std::move(pBatch)),
+m_nDropped(nDropped),
+m_pHandled(std::move(pHandled))
+{
+}
 
 
 wxLogOutput::wxLogOutput(wxEvtHandler* pHandler, bool bMilliseconds) : Output(pml::log::Output::kTsDate | pml::log::Output::kTsTime,bMilliseconds ? pml::log::Output::TS::kMillisecond : pml::log::Output::TS::kSecond),
-m_pHandler(pHandler)
+m_pHandler(pHandler),
+m_pBatch(std::make_shared<wxLogBatchState>(pHandler))
+{
+}
+
+wxLogOutput::~wxLogOutput()
+{
+    if(m_pHandler && m_bBatching)
+    {
+        //let go of the batching state on the GUI thread as it may own a wxTimer
+        m_pHandler->CallAfter([pBatch = m_pBatch]{});
+    }
+}
+
+void wxLogOutput::SetBatching(std::chrono::milliseconds interval, size_t nMaxPending)
 {
+    {
+        std::lock_guard<std::mutex> lg(m_pBatch->mutex);
+        m_pBatch->interval = interval;
+        m_pBatch->nMaxPending = std::max(nMaxPending, size_t(1));
+    }
+    m_bBatching = true;
 }
 
 
 void wxLogOutput::DoOutputMessage(pml::log::Level level, const std::string&  sLog, const std::string& sPrefix)
 {
-    if(m_pHandler && level >= m_level)
+    if(m_pHandler && m_bBatching)
+    {
+        m_batch.vRecords.push_back({GetTime(), level, static_cast<uint32_t>(m_batch.sText.size()), static_cast<uint32_t>(sPrefix.size()), static_cast<uint32_t>(sLog.size())});
+        m_batch.sText += sPrefix;
+        m_batch.sText += sLog;
+    }
+    else if(m_pHandler)
     {
         wxCommandEvent* pEvent = new wxCommandEvent(wxEVT_LOG);
         pEvent->SetTimestamp(wxDateTime::Now().GetTicks());
@@ -23,5 +162,35 @@ void wxLogOutput::DoOutputMessage(pml::log::Level level, const std::string&  sLo
     }
 }
 
+void wxLogOutput::Flush()
+{
+    if(m_batch.vRecords.empty())
+    {
+        return;
+    }
 
+    std::lock_guard<std::mutex> lg(m_pBatch->mutex);
+    auto nBase = static_cast<uint32_t>(m_pBatch->sPending.size());
+    m_pBatch->sPending += m_batch.sText;
+    for(auto record : m_batch.vRecords)
+    {
+        if(m_pBatch->dPending.size() == m_pBatch->nMaxPending)
+        {
+            m_pBatch->dPending.pop_front();
+            ++m_pBatch->nDropped;
+        }
+        record.nOffset += nBase;
+        m_pBatch->dPending.push_back(record);
+    }
+    m_batch.vRecords.clear();
+    m_batch.sText.clear();
+
+    //the text of dropped messages is only thrown away once it is most of what is held
+    if(m_pBatch->dPending.front().nOffset > m_pBatch->sPending.size()/2)
+    {
+        m_pBatch->Compact();
+    }
 
+    //if an event is outstanding the GUI thread posts these once it has been handled
+    m_pBatch->Post();
+}
@@ -0,0 +1,92 @@
+#include "log.h"
+#include "logtoasyncfile.h"
+#include "check.h"
+
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+using namespace pml::log;
+
+/** @brief returns the contents of all the log files in the directory in name order
+**/
+std::string ReadLogs(const std::filesystem::path& directory)
+{
+    std::set<std::filesystem::path> setFiles;
+    for(const auto& entry : std::filesystem::directory_iterator(directory))
+    {
+        if(entry.path().extension() == ".log")
+        {
+            setFiles.insert(entry.path());
+        }
+    }
+    std::stringstream ss;
+    for(const auto& path : setFiles)
+    {
+        ss << std::ifstream(path).rdbuf();
+    }
+    return ss.str();
+}
+
+int main()
+{
+    auto root = std::filesystem::temp_directory_path()/("pml_log_test_asyncfile_"+std::to_string(getpid()));
+    std::filesystem::remove_all(root);
+
+    //small buffers so that many writes are in flight at once
+    auto pOwned = std::make_unique<AsyncFile>(root, Output::kTsNone, Output::TS::kMillisecond, false, 4, 4096);
+    auto pFile = pOwned.get();
+    std::cout << "io_uring " << (pFile->IsUsingIoUring() ? "in use" : "not available, testing the synchronous fallback") << std::endl;
+
+    //the directory is created up front, and created again if it has gone by the time the file is opened
+    CHECK(std::filesystem::is_directory(root));
+    std::filesystem::remove_all(root);
+
+    //kFlush so that WaitUntilDurable waits for the writes to complete
+    pFile->SetDurability(Durability::kFlush);
+    auto nFirst = Stream::AddOutput(std::move(pOwned));
+    info("async") << "first";
+    CHECK(Stream::WaitUntilDurable());
+    CHECK(std::filesystem::is_directory(root));
+    std::string sExisting = ReadLogs(root);
+    CHECK(sExisting == "INFO\t[async]\tfirst\n");
+    Stream::RemoveOutput(nFirst);
+
+    //a file that already exists is appended to, and the writes land in order however many are in flight at once
+    auto pSecond = std::make_unique<AsyncFile>(root, Output::kTsNone, Output::TS::kMillisecond, false, 4, 4096);
+    pFile = pSecond.get();
+    pFile->SetDurability(Durability::kFlush);
+    Stream::AddOutput(std::move(pSecond));
+
+    std::string sExpected = sExisting;
+    for(int i = 0; i < 5000; i++)
+    {
+        info("async") << "message " << i;
+        sExpected += "INFO\t[async]\tmessage "+std::to_string(i)+"\n";
+    }
+    CHECK(Stream::WaitUntilDurable(std::chrono::milliseconds(5000)));
+    CHECK(pFile->GetErrors() == 0);
+    CHECK(ReadLogs(root) == sExpected);
+
+    //kSync waits for the file to be synced as well
+    pFile->SetDurability(Durability::kSync);
+    info("async") << "synced";
+    CHECK(Stream::WaitUntilDurable());
+    CHECK(pFile->GetErrors() == 0);
+    CHECK(ReadLogs(root) == sExpected+"INFO\t[async]\tsynced\n");
+
+    //a file that cannot be opened has its messages written to the console instead, which is not durable
+    std::ofstream(root/"not_a_directory") << "x";
+    auto pBroken = std::make_unique<AsyncFile>(root/"not_a_directory"/"logs", Output::kTsNone, Output::TS::kMillisecond, false, 4, 4096);
+    pBroken->SetDurability(Durability::kFlush);
+    Stream::AddOutput(std::move(pBroken));
+    info("async") << "nowhere";
+    CHECK(Stream::WaitUntilDurable() == false);
+
+    Stream::Stop();
+    std::filesystem::remove_all(root);
+    return g_nFailures;
+}
@@ -0,0 +1,77 @@
+#include "log.h"
+#include "logbroadcast.h"
+#include "check.h"
+
+#include <string>
+#include <vector>
+
+using namespace pml::log;
+
+/** @brief reads everything the subscriber has not read yet
+**/
+std::vector<std::string> ReadAll(Broadcast::Subscriber& subscriber)
+{
+    std::vector<std::string> vMessages;
+    Broadcast::Record rec;
+    while(subscriber.Next(rec))
+    {
+        vMessages.push_back(rec.sMessage);
+    }
+    return vMessages;
+}
+
+int main()
+{
+    //a ring of 8 slots keeps the last 7 messages as the oldest may be being overwritten
+    auto pOwned = std::make_unique<Broadcast>(8);
+    auto subscriber = pOwned->Subscribe();
+    auto keeper = pOwned->Subscribe();
+    Stream::AddOutput(std::move(pOwned));
+
+    //a subscriber that keeps up misses nothing
+    for(int i = 0; i < 5; i++)
+    {
+        info("live") << "message " << i;
+    }
+    CHECK(Stream::FlushAll());
+    auto vMessages = ReadAll(keeper);
+    CHECK(vMessages.size() == 5 && vMessages[0] == "message 0" && vMessages[4] == "message 4");
+    CHECK(keeper.GetOverrun() == 0);
+
+    //a copy starts where the original is and then moves on by itself
+    auto copy = keeper;
+    for(int i = 5; i < 25; i++)
+    {
+        info("live") << "message " << i;
+    }
+    CHECK(Stream::FlushAll());
+
+    //one that falls more than a ring behind skips to the oldest message left and counts the ones it missed
+    vMessages = ReadAll(subscriber);
+    CHECK(vMessages.size() == 7 && vMessages.front() == "message 18" && vMessages.back() == "message 24");
+    CHECK(subscriber.GetOverrun() == 18);
+
+    vMessages = ReadAll(copy);
+    CHECK(vMessages.size() == 7 && vMessages.front() == "message 18");
+    CHECK(copy.GetOverrun() == 13);
+    CHECK(keeper.GetOverrun() == 0);
+
+    //once caught up there is nothing more to read and no more overrun
+    CHECK(ReadAll(subscriber).empty());
+    CHECK(subscriber.GetOverrun() == 18);
+
+    //SkipToOldest goes back over what is still in the ring and SkipToLatest jumps past it
+    subscriber.SkipToOldest();
+    CHECK(ReadAll(subscriber).size() == 7);
+    keeper.SkipToLatest();
+    CHECK(ReadAll(keeper).empty() && keeper.GetOverrun() == 0);
+
+    //a message too long for a slot is cut short and marked as such
+    info("live") << std::string(1000, 'x');
+    CHECK(Stream::FlushAll());
+    Broadcast::Record rec;
+    CHECK(keeper.Next(rec) && rec.bTruncated && rec.sPrefix == "live" && rec.sMessage.size() < 256 && rec.sMessage.size() > 200);
+
+    Stream::Stop();
+    return g_nFailures;
+}
@@ -0,0 +1,77 @@
+#include "log.h"
+#include "check.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace pml::log;
+
+/** @brief counts the messages that reach it
+**/
+class Counter : public Output
+{
+    public:
+        Counter() : Output(kTsNone){}
+
+        std::atomic<size_t> nCount{0};
+
+    protected:
+        void DoOutputMessage(Level, const std::string&, const std::string&) override
+        {
+            ++nCount;
+        }
+};
+
+/** @brief waits, without asking the Manager thread to flush, until the output has had nCount messages
+**/
+bool WaitFor(const Counter* pCounter, size_t nCount)
+{
+    auto timeout = std::chrono::steady_clock::now()+std::chrono::seconds(2);
+    while(pCounter->nCount < nCount)
+    {
+        if(std::chrono::steady_clock::now() > timeout)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+}
+
+int main()
+{
+    Config config;
+    config.consumer = ConsumerMode::kBusyPoll;
+    config.busyPollIdle = std::chrono::milliseconds(5);
+    auto pOwned = std::make_unique<Counter>();
+    auto pCounter = pOwned.get();
+    config.vOutputs.push_back(std::move(pOwned));
+    CHECK(Init(std::move(config)));
+
+    //while messages keep arriving the Manager thread is polling and picks each one up
+    for(size_t i = 1; i <= 100; i++)
+    {
+        info("poll") << i;
+        CHECK(WaitFor(pCounter, i));
+    }
+
+    //once it has been idle for longer than busyPollIdle it sleeps, and a message must still wake it
+    for(size_t i = 1; i <= 5; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        info("poll") << "after idle " << i;
+        CHECK(WaitFor(pCounter, 100+i));
+    }
+
+    //as must a burst from several threads
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::thread first([]{ for(int i = 0; i < 50; i++) info("poll") << "first " << i; });
+    std::thread second([]{ for(int i = 0; i < 50; i++) info("poll") << "second " << i; });
+    first.join();
+    second.join();
+    CHECK(WaitFor(pCounter, 205));
+
+    Stream::Stop();
+    return g_nFailures;
+}
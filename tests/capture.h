@@ -0,0 +1,49 @@
+#ifndef PML_LOG_TEST_CAPTURE_H
+#define PML_LOG_TEST_CAPTURE_H
+
+#include <string>
+#include <vector>
+
+#include "log.h"
+
+/** @brief keeps every message that reaches it. Only the Manager thread touches it until Stream::FlushAll has returned
+**/
+class Capture : public pml::log::Output
+{
+    public:
+        explicit Capture(int nTimestamp=kTsNone, TS resolution=TS::kMillisecond) : Output(nTimestamp, resolution){}
+
+        std::vector<std::string> vMessages;
+        std::vector<std::string> vPrefixes;
+        std::vector<pml::log::Level> vLevels;
+        std::vector<std::string> vLines;        ///< the lines GetLine rendered for the messages
+
+        void Clear()
+        {
+            vMessages.clear();
+            vPrefixes.clear();
+            vLevels.clear();
+            vLines.clear();
+        }
+
+    protected:
+        void DoOutputMessage(pml::log::Level level, const std::string&  sLog, const std::string& sPrefix) override
+        {
+            vMessages.push_back(sLog);
+            vPrefixes.push_back(sPrefix);
+            vLevels.push_back(level);
+            vLines.push_back(GetLine());
+        }
+};
+
+/** @brief waits for everything logged so far to be output and then takes the messages the output has kept
+**/
+inline std::vector<std::string> Take(Capture* pCapture)
+{
+    pml::log::Stream::FlushAll();
+    auto vMessages = std::move(pCapture->vMessages);
+    pCapture->Clear();
+    return vMessages;
+}
+
+#endif
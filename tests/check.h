@@ -0,0 +1,12 @@
+#ifndef PML_LOG_TEST_CHECK_H
+#define PML_LOG_TEST_CHECK_H
+
+#include <iostream>
+
+/** @brief the number of checks that have failed. Each test returns it as its exit code
+**/
+inline int g_nFailures = 0;
+
+#define CHECK(x) do { if(!(x)) { std::cout << __FILE__ << ":" << __LINE__ << "\tcheck failed: " << #x << std::endl; ++g_nFailures; } } while(0)
+
+#endif
@@ -0,0 +1,65 @@
+#include "log.h"
+#include "logcontext.h"
+#include "capture.h"
+#include "check.h"
+
+#include <string>
+#include <thread>
+
+using namespace pml::log;
+
+int main()
+{
+    auto pOwned = std::make_unique<Capture>();
+    auto pCapture = pOwned.get();
+    Stream::AddOutput(std::move(pOwned));
+
+    //a thread with no context has nothing between the prefix and the message
+    CHECK(Context::Current() == nullptr);
+    info("ctx") << "plain";
+    Stream::FlushAll();
+    CHECK(pCapture->vLines.size() == 1 && pCapture->vLines[0] == "INFO\t[ctx]\tplain\n");
+    pCapture->Clear();
+
+    {
+        //nested scopes add their pairs after the enclosing ones and are removed when they end. The snapshot a message refers to outlives the scope
+        ScopedContext req{"req", 42};
+        auto pOuter = Context::Current();
+        CHECK(pOuter != nullptr && pOuter->GetText() == "req=42");
+        info("ctx") << "outer";
+        {
+            ScopedContext user{"user", "bob"};
+            ScopedContext missing{"name", static_cast<const char*>(nullptr)};
+            auto pInner = Context::Current();
+            CHECK(pInner->GetEntries().size() == 3 && pInner->GetEntries()[0].first == "req" && pInner->GetEntries()[2].second == "(null)");
+            CHECK(pInner->GetVersion() != pOuter->GetVersion());
+            info("ctx") << "inner";
+        }
+        CHECK(Context::Current() == pOuter);
+        info("ctx") << "outer again";
+    }
+    CHECK(Context::Current() == nullptr);
+    Stream::FlushAll();
+    CHECK(pCapture->vLines.size() == 3);
+    CHECK(pCapture->vLines.size() == 3 && pCapture->vLines[0] == "INFO\t[ctx]\t{req=42}\touter\n");
+    CHECK(pCapture->vLines.size() == 3 && pCapture->vLines[1] == "INFO\t[ctx]\t{req=42 user=bob name=(null)}\tinner\n");
+    CHECK(pCapture->vLines.size() == 3 && pCapture->vLines[2] == "INFO\t[ctx]\t{req=42}\touter again\n");
+    pCapture->Clear();
+
+    //each thread has its own context
+    ScopedContext main{"thread", "main"};
+    std::thread other([]{
+        ScopedContext worker{"thread", "worker"};
+        info("ctx") << "from worker";
+        Stream::FlushAll();
+    });
+    other.join();
+    info("ctx") << "from main";
+    Stream::FlushAll();
+    CHECK(pCapture->vLines.size() == 2);
+    CHECK(pCapture->vLines.size() == 2 && pCapture->vLines[0] == "INFO\t[ctx]\t{thread=worker}\tfrom worker\n");
+    CHECK(pCapture->vLines.size() == 2 && pCapture->vLines[1] == "INFO\t[ctx]\t{thread=main}\tfrom main\n");
+
+    Stream::Stop();
+    return g_nFailures;
+}
@@ -0,0 +1,97 @@
+#include "log.h"
+#include "logtofile.h"
+#include "check.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+using namespace pml::log;
+
+/** @brief counts the commits it is asked for and can be made to fail them
+**/
+class Committer : public Output
+{
+    public:
+        Committer() : Output(kTsNone){}
+
+        std::atomic<size_t> nFlush{0};
+        std::atomic<size_t> nSync{0};
+        std::atomic_bool bFail{false};
+
+    protected:
+        void DoOutputMessage(Level, const std::string&, const std::string&) override {}
+
+        bool Commit(Durability durability) override
+        {
+            ++(durability == Durability::kSync ? nSync : nFlush);
+            return bFail == false;
+        }
+};
+
+int main()
+{
+    auto root = std::filesystem::temp_directory_path()/("pml_log_test_durable_"+std::to_string(getpid()));
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+
+    auto pOwned = std::make_unique<Committer>();
+    auto pCommitter = pOwned.get();
+    pCommitter->SetDurability(Level::kWarning, Durability::kFlush);
+    pCommitter->SetDurability(Level::kError, Durability::kSync);
+    auto nCommitter = Stream::AddOutput(std::move(pOwned));
+
+    //a batch with no messages that need committing is not committed
+    info("durable") << "not committed";
+    CHECK(Stream::WaitUntilDurable());
+    CHECK(pCommitter->nFlush == 0 && pCommitter->nSync == 0);
+
+    //the highest durability in the batch is asked for
+    warning("durable") << "flushed";
+    CHECK(Stream::WaitUntilDurable());
+    CHECK(pCommitter->nFlush == 1 && pCommitter->nSync == 0);
+    error("durable") << "synced";
+    CHECK(Stream::WaitUntilDurable());
+    CHECK(pCommitter->nSync == 1);
+
+    //a commit that fails is passed to the thread waiting for it, but FlushAll only waits for the messages to be output
+    pCommitter->bFail = true;
+    warning("durable") << "lost";
+    CHECK(Stream::WaitUntilDurable() == false);
+    CHECK(Stream::FlushAll());
+
+    //and the next batch that commits clears it
+    pCommitter->bFail = false;
+    warning("durable") << "flushed again";
+    CHECK(Stream::WaitUntilDurable());
+    Stream::RemoveOutput(nCommitter);
+
+    //a File with kSync has the message in the file once the wait returns
+    auto pFile = std::make_unique<File>(root, Output::kTsNone, Output::TS::kMillisecond, false);
+    pFile->SetDurability(Durability::kSync);
+    auto nFile = Stream::AddOutput(std::move(pFile));
+    warning("durable") << "on disk";
+    CHECK(Stream::WaitUntilDurable());
+    std::stringstream ss;
+    for(const auto& entry : std::filesystem::directory_iterator(root))
+    {
+        ss << std::ifstream(entry.path()).rdbuf();
+    }
+    CHECK(ss.str() == "WARNING\t[durable]\ton disk\n");
+    Stream::RemoveOutput(nFile);
+
+    //a File that cannot create its file writes to the console instead, which is not durable
+    std::ofstream(root/"not_a_directory") << "x";
+    auto pBroken = std::make_unique<File>(root/"not_a_directory"/"logs", Output::kTsNone, Output::TS::kMillisecond, false);
+    pBroken->SetDurability(Durability::kFlush);
+    Stream::AddOutput(std::move(pBroken));
+    warning("durable") << "nowhere";
+    CHECK(Stream::WaitUntilDurable() == false);
+
+    Stream::Stop();
+    std::filesystem::remove_all(root);
+    return g_nFailures;
+}
@@ -0,0 +1,82 @@
+#include "log.h"
+#include "check.h"
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pml::log;
+
+constexpr size_t kThreads = 4;
+
+/** @brief counts the messages from each thread as they are output and can be made to hold up the Manager thread in Flush
+**/
+class Counter : public Output
+{
+    public:
+        Counter() : Output(kTsNone){}
+
+        std::array<std::atomic<size_t>, kThreads> aCount{};
+        std::atomic_bool bHold{false};
+
+    protected:
+        void DoOutputMessage(Level, const std::string&  sLog, const std::string&) override
+        {
+            aCount[std::stoul(sLog)]++;
+        }
+
+        void Flush() override
+        {
+            while(bHold)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+};
+
+int main()
+{
+    Config config;
+    config.nShards = kThreads;
+    auto pOwned = std::make_unique<Counter>();
+    auto pCounter = pOwned.get();
+    config.vOutputs.push_back(std::move(pOwned));
+    CHECK(Init(std::move(config)));
+
+    //each thread is in its own shard and every message it logged before FlushAll must have been output when it returns
+    std::atomic<size_t> nLate{0};
+    std::vector<std::thread> vThreads;
+    for(size_t nThread = 0; nThread < kThreads; nThread++)
+    {
+        vThreads.emplace_back([&, nThread]{
+            for(size_t nRound = 1; nRound <= 20; nRound++)
+            {
+                for(size_t i = 0; i < 100; i++)
+                {
+                    info() << nThread;
+                }
+                if(Stream::FlushAll(std::chrono::milliseconds(5000)) == false || pCounter->aCount[nThread] < nRound*100)
+                {
+                    ++nLate;
+                }
+            }
+        });
+    }
+    for(auto& thread : vThreads)
+    {
+        thread.join();
+    }
+    CHECK(nLate == 0);
+
+    //the barrier gives up once the timeout has passed if an output is stuck
+    pCounter->bHold = true;
+    info() << 0;
+    CHECK(Stream::FlushAll(std::chrono::milliseconds(50)) == false);
+    pCounter->bHold = false;
+    CHECK(Stream::FlushAll());
+
+    Stream::Stop();
+    return g_nFailures;
+}
@@ -0,0 +1,82 @@
+#include "log.h"
+#include "capture.h"
+#include "check.h"
+
+#include <string>
+#include <vector>
+
+using namespace pml::log;
+using detail::Check;
+
+//the compile time check
+static_assert(Check<>("no placeholders"));
+static_assert(Check<int, std::string>("took {} us for {}"));
+static_assert(Check<int>("{{literal}} {}"));
+static_assert(Check<int, double, const char*>("{:x} {:.3f} {:s}"));
+static_assert(Check<int>("") == false);
+static_assert(Check<>("{}") == false);
+static_assert(Check<int>("{} {}") == false);
+static_assert(Check<int, int>("{}") == false);
+static_assert(Check<int>("{:.2f}") == false);
+static_assert(Check<double>("{:x}") == false);
+static_assert(Check<const char*>("{:d}") == false);
+static_assert(Check<int>("{") == false);
+static_assert(Check<int>("{} }") == false);
+static_assert(Check<int>("{:.}") == false);
+
+struct Point
+{
+    int x;
+    int y;
+};
+
+std::ostream& operator<<(std::ostream& os, const Point& point)
+{
+    return os << "(" << point.x << "," << point.y << ")";
+}
+
+int main()
+{
+    auto pOwned = std::make_unique<Capture>();
+    auto pCapture = pOwned.get();
+    Stream::AddOutput(std::move(pOwned));
+
+    info().format(PML_LOG_FMT("took {} us for {}"), 42, std::string("name"));
+    info().format(PML_LOG_FMT("{:x} {:X} {:o} {:b} {}"), 255, 255, 8, 5, -7);
+    info().format(PML_LOG_FMT("{:.3f} {:e} {}"), 1.5, 1000.0, 0.25);
+    info().format(PML_LOG_FMT("{} {} {} {}"), true, 'c', static_cast<const char*>(nullptr), Point{1, 2});
+    info().format(PML_LOG_FMT("{{{}}}"), 1);
+    info().format("plain {} literal", 7);
+    format(Level::kInfo, "svc", "free {}", 1) << " and more";
+    format(Level::kInfo, Prefix("svc"), PML_LOG_FMT("free {:x}"), 255);
+
+    //a message longer than the inline buffer is formatted in full
+    std::string sLong(300, 'x');
+    info().format(PML_LOG_FMT("{} {}"), sLong, 123456789);
+
+    //C++17 checks a plain format string when the message is written and marks the message if it does not match
+    std::string sFormat("runtime {} {}");
+    info().format(RuntimeFormat(sFormat), 1);
+#ifndef __cpp_consteval
+    info().format("missing {}");
+#else
+    info().format(RuntimeFormat("missing {}"));
+#endif
+
+    auto vMessages = Take(pCapture);
+    std::vector<std::string> vExpected{"took 42 us for name\n", "ff FF 10 101 -7\n", "1.500 1e+03 0.25\n", "true c (null) (1,2)\n", "{1}\n",
+                                       "plain 7 literal\n", "free 1 and more\n", "free ff\n", sLong+" 123456789\n",
+                                       "runtime 1 {}"+std::string(detail::kFormatError)+"\n", "missing {}"+std::string(detail::kFormatError)+"\n"};
+    CHECK(vMessages.size() == vExpected.size());
+    for(size_t i = 0; i < vMessages.size() && i < vExpected.size(); i++)
+    {
+        if(vMessages[i] != vExpected[i])
+        {
+            std::cout << "got " << vMessages[i] << "expected " << vExpected[i];
+        }
+        CHECK(vMessages[i] == vExpected[i]);
+    }
+
+    Stream::Stop();
+    return g_nFailures;
+}
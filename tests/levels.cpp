@@ -0,0 +1,91 @@
+#include "log.h"
+#include "capture.h"
+#include "check.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pml::log;
+
+int main()
+{
+    auto pOwned = std::make_unique<Capture>();
+    auto pCapture = pOwned.get();
+    auto nCapture = Stream::AddOutput(std::move(pOwned));
+    Prefix net("net");
+    Prefix other("other");
+
+    //a level set for a prefix overrides the output level for that prefix only
+    Stream::SetOutputLevel(nCapture, Level::kInfo);
+    Stream::SetOutputLevel(nCapture, net, Level::kTrace);
+    trace(net) << "net trace";
+    debug(other) << "other debug";
+    info(other) << "other info";
+    auto vMessages = Take(pCapture);
+    CHECK(vMessages.size() == 2);
+    CHECK(vMessages.size() == 2 && vMessages[0] == "net trace\n" && vMessages[1] == "other info\n");
+    CHECK(Stream::IsEnabled(Level::kTrace, net));
+    CHECK(Stream::IsEnabled(Level::kDebug, other) == false);
+
+    //levels are changed while producers are logging. Both settings accept debug net and info messages, so none of them may be lost however the change lands.
+    //Only the first accepts debug other, which must stop once the second has been set
+    constexpr size_t kThreads = 4;
+    constexpr size_t kMessages = 20000;
+    std::atomic_bool bRun{true};
+    std::thread control([&]{
+        auto bFirst = true;
+        while(bRun)
+        {
+            if(bFirst)
+            {
+                Stream::SetOutputLevel(nCapture, Level::kDebug);
+                Stream::SetOutputLevel(nCapture, net, Level::kDebug);
+            }
+            else
+            {
+                Stream::SetOutputLevel(nCapture, Level::kInfo);
+                Stream::SetOutputLevel(nCapture, net, Level::kDebug);
+            }
+            bFirst = !bFirst;
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<std::thread> vProducers;
+    for(size_t nThread = 0; nThread < kThreads; nThread++)
+    {
+        vProducers.emplace_back([&]{
+            for(size_t i = 0; i < kMessages; i++)
+            {
+                debug(net) << "must arrive";
+                info(other) << "must arrive";
+                debug(other) << "may arrive";
+            }
+        });
+    }
+    for(auto& producer : vProducers)
+    {
+        producer.join();
+    }
+    bRun = false;
+    control.join();
+
+    vMessages = Take(pCapture);
+    size_t nMust = 0;
+    for(const auto& sMessage : vMessages)
+    {
+        nMust += (sMessage == "must arrive\n");
+    }
+    CHECK(nMust == 2*kThreads*kMessages);
+
+    Stream::SetOutputLevel(nCapture, Level::kInfo);
+    debug(other) << "filtered";
+    debug(net) << "kept";
+    vMessages = Take(pCapture);
+    CHECK(vMessages.size() == 1 && vMessages[0] == "kept\n");
+
+    Stream::Stop();
+    return g_nFailures;
+}
@@ -0,0 +1,92 @@
+#include "log.h"
+#include "check.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pml::log;
+
+/** @brief keeps each message and its time. Only the Manager thread touches it until Stream::FlushAll has returned
+**/
+class Recorder : public Output
+{
+    public:
+        Recorder() : Output(kTsNone){}
+
+        std::vector<std::string> vMessages;
+        std::vector<std::chrono::system_clock::time_point> vTimes;
+
+    protected:
+        void DoOutputMessage(Level, const std::string& sLog, const std::string&) override
+        {
+            vMessages.push_back(sLog);
+            vTimes.push_back(GetTime());
+        }
+};
+
+int main()
+{
+    constexpr size_t kThreads = 8;
+    constexpr size_t kMessages = 2000;
+
+    Config config;
+    config.nShards = 3;     //fewer shards than threads so some threads share one
+    config.nQueueCapacity = kThreads*kMessages;
+    auto pOwned = std::make_unique<Recorder>();
+    auto pRecorder = pOwned.get();
+    config.vOutputs.push_back(std::move(pOwned));
+    CHECK(Init(std::move(config)));
+
+    std::vector<std::thread> vThreads;
+    for(size_t nThread = 0; nThread < kThreads; nThread++)
+    {
+        vThreads.emplace_back([nThread]{
+            for(size_t i = 0; i < kMessages; i++)
+            {
+                info("order") << nThread << " " << i;
+                if(i % 100 == 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for(auto& th : vThreads)
+    {
+        th.join();
+    }
+    CHECK(Stream::FlushAll());
+
+    //messages from different shards may be interleaved in any way across batches, but each thread's messages come out in the order it logged them with times that never go backwards
+    CHECK(pRecorder->vMessages.size() == kThreads*kMessages);
+    std::vector<size_t> vNext(kThreads, 0);
+    std::vector<std::chrono::system_clock::time_point> vLast(kThreads);
+    size_t nOutOfOrder = 0;
+    for(size_t i = 0; i < pRecorder->vMessages.size(); i++)
+    {
+        size_t nThread = 0;
+        size_t nMessage = 0;
+        if(std::sscanf(pRecorder->vMessages[i].c_str(), "%zu %zu", &nThread, &nMessage) != 2 || nThread >= kThreads)
+        {
+            ++nOutOfOrder;
+            continue;
+        }
+        if(nMessage != vNext[nThread] || pRecorder->vTimes[i] < vLast[nThread])
+        {
+            ++nOutOfOrder;
+        }
+        vNext[nThread] = nMessage+1;
+        vLast[nThread] = pRecorder->vTimes[i];
+    }
+    CHECK(nOutOfOrder == 0);
+    for(auto nNext : vNext)
+    {
+        CHECK(nNext == kMessages);
+    }
+
+    Stream::Stop();
+    return g_nFailures;
+}
@@ -0,0 +1,92 @@
+#include "log.h"
+#include "logbuffer.h"
+#include "check.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pml::log;
+
+/** @brief keeps every message that reaches it and can be made to hold up the Manager thread part way through outputting one, so that its pool slot is not released
+**/
+class Holder : public Output
+{
+    public:
+        Holder() : Output(kTsNone){}
+
+        std::vector<std::string> vMessages;
+        std::atomic_bool bHold{false};
+        std::atomic_bool bHolding{false};
+
+    protected:
+        void DoOutputMessage(Level, const std::string&  sLog, const std::string&) override
+        {
+            vMessages.push_back(sLog);
+            while(bHold)
+            {
+                bHolding = true;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            bHolding = false;
+        }
+};
+
+int main()
+{
+    //the pool hands out each slot once until it is released
+    detail::RecordPool pool(3, 16);
+    std::vector<uint32_t> vSlots;
+    for(int i = 0; i < 3; i++)
+    {
+        vSlots.push_back(pool.Claim());
+    }
+    CHECK(vSlots[0] != vSlots[1] && vSlots[1] != vSlots[2] && vSlots[0] != vSlots[2]);
+    CHECK(pool.Claim() == detail::RecordPool::kNoSlot);
+    CHECK(pool.GetExhausted() == 1);
+    pool.Release(vSlots[1]);
+    CHECK(pool.Claim() == vSlots[1]);
+    CHECK(pool.Claim() == detail::RecordPool::kNoSlot);
+    CHECK(pool.GetExhausted() == 2);
+
+    Config config;
+    config.nPoolSlots = 2;
+    config.nPoolCapacity = 16;
+    auto pOwned = std::make_unique<Holder>();
+    auto pHolder = pOwned.get();
+    config.vOutputs.push_back(std::move(pOwned));
+    CHECK(Init(std::move(config)));
+    CHECK(Stream::UseRecordPool(4, 64) == false);
+
+    //while the Manager thread holds one slot and another message waits in the queue the pool is empty and further messages are dropped
+    pHolder->bHold = true;
+    info() << "first";
+    while(pHolder->bHolding == false)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    info() << "second";
+    info() << "dropped";
+    pHolder->bHold = false;
+    CHECK(Stream::FlushAll());
+    CHECK(pHolder->vMessages.size() == 2 && pHolder->vMessages[0] == "first\n" && pHolder->vMessages[1] == "second\n");
+
+    //once they have been output the slots are used again
+    pHolder->vMessages.clear();
+    for(int i = 0; i < 10; i++)
+    {
+        info() << "again " << i;
+        CHECK(Stream::FlushAll());
+    }
+    CHECK(pHolder->vMessages.size() == 10 && pHolder->vMessages[9] == "again 9\n");
+
+    //a message longer than a slot is cut short but still ends the line
+    pHolder->vMessages.clear();
+    info() << "0123456789abcdefghij";
+    CHECK(Stream::FlushAll());
+    CHECK(pHolder->vMessages.size() == 1 && pHolder->vMessages[0] == "0123456789abcde\n");
+
+    Stream::Stop();
+    return g_nFailures;
+}
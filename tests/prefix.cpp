@@ -0,0 +1,70 @@
+#include "log.h"
+#include "capture.h"
+#include "check.h"
+
+#include <string>
+#include <vector>
+
+using namespace pml::log;
+
+int main()
+{
+    //a name is interned once
+    Prefix net("net");
+    Prefix again("net");
+    Prefix disk("disk");
+    CHECK(net.GetId() == again.GetId());
+    CHECK(net.GetId() != disk.GetId());
+    CHECK(net.GetName() == "net");
+
+    //a prefix level set before the output is added is used once it is
+    auto pOwned = std::make_unique<Capture>();
+    auto pCapture = pOwned.get();
+    pOwned->SetOutputLevel(Level::kWarning);
+    pOwned->SetPrefixLevel(net, Level::kDebug);
+    CHECK(pOwned->GetOutputLevel(net) == Level::kDebug);
+    CHECK(pOwned->GetOutputLevel(disk) == Level::kWarning);
+    Stream::AddOutput(std::move(pOwned));
+
+    auto pSecond = std::make_unique<Capture>();
+    auto pOther = pSecond.get();
+    pSecond->SetOutputLevel(Level::kWarning);
+    Stream::AddOutput(std::move(pSecond));
+
+    debug(net) << "net debug";
+    info(disk) << "disk info";
+    warning(disk) << "disk warning";
+    auto vMessages = Take(pCapture);
+    CHECK(vMessages.size() == 2 && vMessages[0] == "net debug\n" && vMessages[1] == "disk warning\n");
+    vMessages = Take(pOther);
+    CHECK(vMessages.size() == 1 && vMessages[0] == "disk warning\n");
+
+    //and the prefix can be given a level on every output at once
+    Stream::SetOutputLevel(disk, Level::kInfo);
+    info(disk) << "disk info";
+    info(net) << "net info";
+    vMessages = Take(pCapture);
+    CHECK(vMessages.size() == 2);
+    vMessages = Take(pOther);
+    CHECK(vMessages.size() == 1 && vMessages[0] == "disk info\n");
+
+    //once the registry is full new names are carried with each message instead
+    std::vector<Prefix> vPrefixes;
+    for(size_t i = 0; i < Prefix::kMaxPrefixes; i++)
+    {
+        vPrefixes.emplace_back("prefix"+std::to_string(i));
+    }
+    Prefix full("full");
+    CHECK(full.GetId() == Prefix::kUnregistered);
+    CHECK(full.GetName() == "full");
+    Stream::SetOutputLevel(Level::kTrace);
+    info(full) << "by name";
+    Stream(Level::kInfo, "also full") << "by string";
+    Stream::FlushAll();
+    CHECK(pCapture->vPrefixes.size() == 2 && pCapture->vPrefixes[0] == "full" && pCapture->vPrefixes[1] == "also full");
+    vMessages = Take(pCapture);
+    CHECK(vMessages.size() == 2 && vMessages[0] == "by name\n" && vMessages[1] == "by string\n");
+
+    Stream::Stop();
+    return g_nFailures;
+}
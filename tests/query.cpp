@@ -0,0 +1,107 @@
+#include "log.h"
+#include "logindex.h"
+#include "logtofile.h"
+#include "check.h"
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <unistd.h>
+
+using namespace pml::log;
+
+/** @brief runs pml_log_query and returns what it writes to stdout and stderr
+**/
+std::string Query(const std::string& sQuery, const std::string& sArgs)
+{
+    std::string sResult;
+    auto pPipe = popen((sQuery+" "+sArgs+" 2>&1").c_str(), "r");
+    if(pPipe)
+    {
+        std::array<char, 256> aBuffer;
+        while(fgets(aBuffer.data(), aBuffer.size(), pPipe))
+        {
+            sResult += aBuffer.data();
+        }
+        pclose(pPipe);
+    }
+    return sResult;
+}
+
+IndexBlock MakeBlock(uint64_t nOffset, uint64_t nLength, int nLevel)
+{
+    IndexBlock block{};
+    block.nStart = 0;
+    block.nEnd = std::numeric_limits<int32_t>::max();
+    block.nOffset = nOffset;
+    block.nLength = nLength;
+    block.aCount[nLevel] = 1;
+    return block;
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        std::cout << "Usage: pml_log_test_query <path to pml_log_query>" << std::endl;
+        return 1;
+    }
+    std::string sQuery = argv[1];
+    auto root = std::filesystem::temp_directory_path()/("pml_log_test_query_"+std::to_string(getpid()));
+    std::filesystem::remove_all(root);
+
+    //the parts of a file that no index block covers are always scanned: before the first block, between blocks and after the last one
+    auto gaps = root/"gaps";
+    std::filesystem::create_directories(gaps);
+    const std::array<std::string, 5> aLines = {"10:00:01\tERROR\t[a]\tbefore the index\n", "10:10:00\tINFO\t[a]\tfirst block\n",
+                                               "10:20:00\tERROR\t[a]\tbetween the blocks\n", "10:30:00\tDEBUG\t[a]\tsecond block\n",
+                                               "10:40:00\tERROR\t[a]\tafter the index\n"};
+    std::ofstream ofLog(gaps/"2026-10-19T10.log", std::ios::binary);
+    std::array<uint64_t, 6> aOffset{0};
+    for(size_t i = 0; i < aLines.size(); i++)
+    {
+        ofLog << aLines[i];
+        aOffset[i+1] = aOffset[i]+aLines[i].size();
+    }
+    ofLog.close();
+
+    std::ofstream ofIndex(gaps/"2026-10-19T10.idx", std::ios::binary);
+    IndexHeader header{};
+    std::memcpy(header.aMagic, IndexHeader::kMagic, sizeof(header.aMagic));
+    header.nHour = 0;
+    auto first = MakeBlock(aOffset[1], aLines[1].size(), static_cast<int>(Level::kInfo));
+    auto second = MakeBlock(aOffset[3], aLines[3].size(), static_cast<int>(Level::kDebug));
+    ofIndex.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ofIndex.write(reinterpret_cast<const char*>(&first), sizeof(first));
+    ofIndex.write(reinterpret_cast<const char*>(&second), sizeof(second));
+    ofIndex.close();
+
+    auto sResult = Query(sQuery, "--utc --level error "+gaps.string());
+    CHECK(sResult == aLines[0]+aLines[2]+aLines[4]);
+    sResult = Query(sQuery, "--utc --level info "+gaps.string());
+    CHECK(sResult == aLines[0]+aLines[1]+aLines[2]+aLines[4]);
+
+    //the blocks a File writes let the query skip the ones with nothing at the level asked for
+    auto pFile = std::make_unique<File>(root/"file");
+    pFile->SetIndexInterval(std::chrono::seconds(3600));
+    Stream::AddOutput(std::move(pFile));
+    info("net") << "connected";
+    warning("net") << "slow reply";
+    info("disk") << "mounted";
+    Stream::Stop();
+
+    sResult = Query(sQuery, "--level warning --stats "+(root/"file").string());
+    CHECK(sResult.find("slow reply") != std::string::npos);
+    CHECK(sResult.find("connected") == std::string::npos && sResult.find("mounted") == std::string::npos);
+    CHECK(sResult.find("indexed") != std::string::npos && sResult.find("(0 indexed)") == std::string::npos);
+
+    sResult = Query(sQuery, "--level info --prefix disk "+(root/"file").string());
+    CHECK(sResult.find("mounted") != std::string::npos && sResult.find("slow reply") == std::string::npos);
+
+    std::filesystem::remove_all(root);
+    return g_nFailures;
+}
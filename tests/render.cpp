@@ -0,0 +1,75 @@
+#include "log.h"
+#include "check.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace pml::log;
+
+/** @brief keeps the line it was given for each message and where it was rendered
+**/
+class Recorder : public Output
+{
+    public:
+        Recorder(int nTimestamp, TS resolution) : Output(nTimestamp, resolution){}
+
+        std::vector<const std::string*> vRendered;
+        size_t nAgain = 0;
+        std::vector<std::string> vLines;
+        std::vector<std::chrono::system_clock::time_point> vTimes;
+
+    protected:
+        void DoOutputMessage(Level, const std::string&, const std::string&) override
+        {
+            const auto& sLine = GetLine();
+            //asking again gives the line already rendered
+            nAgain += (&GetLine() == &sLine && GetLine() == sLine) ? 0 : 1;
+            vRendered.push_back(&sLine);
+            vLines.push_back(sLine);
+            vTimes.push_back(GetTime());
+        }
+};
+
+int main()
+{
+    auto pFirst = std::make_unique<Recorder>(Output::kTsDate | Output::kTsTime, Output::TS::kMillisecond);
+    auto pSecond = std::make_unique<Recorder>(Output::kTsDate | Output::kTsTime, Output::TS::kMillisecond);
+    auto pOther = std::make_unique<Recorder>(Output::kTsTime, Output::TS::kMicrosecond);
+    auto pA = pFirst.get();
+    auto pB = pSecond.get();
+    auto pC = pOther.get();
+    Stream::AddOutput(std::move(pFirst));
+    Stream::AddOutput(std::move(pSecond));
+    Stream::AddOutput(std::move(pOther));
+
+    for(int i = 0; i < 10; i++)
+    {
+        info("render") << "message " << i;
+    }
+    CHECK(Stream::FlushAll());
+
+    CHECK(pA->vLines.size() == 10 && pB->vLines.size() == 10 && pC->vLines.size() == 10);
+    CHECK(pA->nAgain == 0 && pB->nAgain == 0 && pC->nAgain == 0);
+    if(pA->vLines.size() == 10 && pB->vLines.size() == 10 && pC->vLines.size() == 10)
+    {
+        for(size_t i = 0; i < 10; i++)
+        {
+            //outputs with the same timestamp format share the one line rendered for the message
+            CHECK(pA->vRendered[i] == pB->vRendered[i]);
+            CHECK(pA->vLines[i] == pB->vLines[i]);
+
+            //a different format has its own line, with the same time
+            CHECK(pC->vRendered[i] != pA->vRendered[i]);
+            CHECK(pC->vLines[i] != pA->vLines[i]);
+            CHECK(pA->vTimes[i] == pC->vTimes[i]);
+
+            auto sEnd = "INFO\t[render]\tmessage "+std::to_string(i)+"\n";
+            CHECK(pA->vLines[i].size() > sEnd.size() && pA->vLines[i].compare(pA->vLines[i].size()-sEnd.size(), sEnd.size(), sEnd) == 0);
+            CHECK(pC->vLines[i].size() > sEnd.size() && pC->vLines[i].compare(pC->vLines[i].size()-sEnd.size(), sEnd.size(), sEnd) == 0);
+        }
+    }
+
+    Stream::Stop();
+    return g_nFailures;
+}
@@ -0,0 +1,143 @@
+#include "log.h"
+#include "logcollector.h"
+#include "logcontext.h"
+#include "logshm.h"
+#include "logtoshm.h"
+#include "capture.h"
+#include "check.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using namespace pml::log;
+
+/** @brief polls the collector until its output has had nCount messages
+**/
+bool CollectUntil(Collector& collector, const Capture* pCapture, size_t nCount)
+{
+    auto timeout = std::chrono::steady_clock::now()+std::chrono::seconds(2);
+    while(pCapture->vMessages.size() < nCount)
+    {
+        if(std::chrono::steady_clock::now() > timeout)
+        {
+            return false;
+        }
+        if(collector.Poll() == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    return true;
+}
+
+/** @brief a SharedMemory output that only takes the messages with the given prefix
+**/
+std::unique_ptr<SharedMemory> MakeRing(const std::string& sChannel, const Prefix& prefix, size_t nCapacity)
+{
+    auto pRing = std::make_unique<SharedMemory>(sChannel, nCapacity);
+    pRing->SetOutputLevel(Level::kCritical);
+    pRing->SetPrefixLevel(prefix, Level::kTrace);
+    return pRing;
+}
+
+int main()
+{
+    auto sChannel = "test"+std::to_string(getpid());
+    static const Prefix kWrap("wrap");
+    static const Prefix kA("a");
+    static const Prefix kB("b");
+
+    //the smallest ring there is, so that it wraps many times
+    auto pOwned = MakeRing(sChannel, kWrap, 4096);
+    auto pWrap = pOwned.get();
+    CHECK(pWrap->IsOpen());
+    Stream::AddOutput(std::move(pOwned));
+    Stream::AddOutput(MakeRing(sChannel, kA, 4096));
+    Stream::AddOutput(MakeRing(sChannel, kB, 4096));
+
+    Collector collector(sChannel, std::chrono::milliseconds(10));
+    auto pCaptureOwned = std::make_unique<Capture>();
+    auto pCapture = pCaptureOwned.get();
+    collector.AddOutput(std::move(pCaptureOwned));
+
+    //records of many lengths so that some do not fit before the end of the ring and are written after a padding marker.
+    //work out where the producer's head goes to make sure that happens
+    auto lengthOf = [](size_t i){ return 1+(i*37)%150; };
+    uint64_t nHead = 0;
+    size_t nPadded = 0;
+    std::vector<std::string> vExpected;
+    for(size_t i = 0; i < 400; i++)
+    {
+        auto sMessage = std::to_string(i)+":"+std::string(lengthOf(i), 'x');
+        info(kWrap) << sMessage;
+        sMessage += "\n";
+        auto nLength = (sizeof(ShmRecord)+kWrap.GetName().size()+sMessage.size()+7) & ~size_t(7);
+        auto nToEnd = 4096-(nHead & 4095);
+        if(nToEnd < nLength)
+        {
+            nHead += nToEnd;
+            ++nPadded;
+        }
+        nHead += nLength;
+        vExpected.push_back(sMessage);
+
+        if(i % 10 == 9)
+        {
+            //a batch is well under a quarter of the ring so nothing is dropped as long as the collector keeps up
+            Stream::FlushAll();
+            CHECK(CollectUntil(collector, pCapture, i+1));
+        }
+    }
+    CHECK(nHead > 4*4096 && nPadded > 2);
+    CHECK(pCapture->vMessages == vExpected);
+    CHECK(pWrap->GetDropped() == 0);
+    CHECK(collector.GetProducerCount() == 3);
+    pCapture->Clear();
+
+    //the context goes through the ring with the message
+    {
+        ScopedContext request{"req", 7};
+        info(kWrap) << "with context";
+    }
+    Stream::FlushAll();
+    CHECK(CollectUntil(collector, pCapture, 1));
+    CHECK(pCapture->vLines.size() == 1 && pCapture->vLines[0] == "INFO\t[wrap]\t{req=7}\twith context\n");
+    pCapture->Clear();
+
+    //when the collector does not read the ring it fills up and the rest are dropped and counted rather than waited for
+    std::vector<std::string> vSent;
+    for(size_t i = 0; i < 100; i++)
+    {
+        auto sMessage = "dropped? "+std::to_string(i)+std::string(100, 'y');
+        info(kWrap) << sMessage;
+        vSent.push_back(sMessage+"\n");
+    }
+    Stream::FlushAll();
+    auto nDropped = pWrap->GetDropped();
+    CHECK(nDropped > 0 && nDropped < 100);
+    CHECK(collector.GetDropped() == nDropped);
+    CHECK(CollectUntil(collector, pCapture, 100-nDropped));
+    vSent.resize(100-nDropped);
+    CHECK(pCapture->vMessages == vSent);
+    pCapture->Clear();
+
+    //messages from different rings are merged back in to the order they were logged in
+    vExpected.clear();
+    for(size_t i = 0; i < 50; i++)
+    {
+        info(kA) << "a" << i;
+        info(kB) << "b" << i;
+        vExpected.push_back("a"+std::to_string(i)+"\n");
+        vExpected.push_back("b"+std::to_string(i)+"\n");
+    }
+    Stream::FlushAll();
+    CHECK(CollectUntil(collector, pCapture, vExpected.size()));
+    CHECK(pCapture->vMessages == vExpected);
+    CHECK(pCapture->vPrefixes.size() == 100 && pCapture->vPrefixes[0] == "a" && pCapture->vPrefixes[1] == "b");
+
+    Stream::Stop();
+    return g_nFailures;
+}
@@ -0,0 +1,128 @@
+#include "log.h"
+#include "logbuffer.h"
+#include "capture.h"
+#include "check.h"
+
+#include <string>
+#include <vector>
+
+using namespace pml::log;
+
+int main()
+{
+    auto pOwned = std::make_unique<Capture>();
+    auto pCapture = pOwned.get();
+    auto nCapture = Stream::AddOutput(std::move(pOwned));
+
+    //the library has been set up by AddOutput so it is too late to Init
+    CHECK(Init(Config{}) == false);
+
+    //a chain ending in std::endl or std::flush is one record
+    info("test") << "value " << 42 << std::endl;
+    auto vMessages = Take(pCapture);
+    CHECK(vMessages.size() == 1);
+    CHECK(vMessages.size() == 1 && vMessages[0] == "value 42\n");
+
+    info("test") << "flushed" << std::flush;
+    vMessages = Take(pCapture);
+    CHECK(vMessages.size() == 1);
+
+    //as is one too long for the inline buffer
+    std::string sLong(300, 'x');
+    info("test") << sLong << std::endl;
+    vMessages = Take(pCapture);
+    CHECK(vMessages.size() == 1 && vMessages[0] == sLong+"\n");
+
+    //a line of typical length fits in the inline buffer so it needs no allocation
+    {
+        detail::MessageBuffer buffer(nullptr);
+        std::ostream os(&buffer);
+        os << std::string(199, 'x') << std::endl;
+        CHECK(buffer.IsInline() && buffer.GetLength() == 200);
+    }
+
+    //a moved Stream logs its message once, from the Stream it was moved to
+    {
+        Stream first(Level::kInfo, "test");
+        first << "moved";
+        Stream second(std::move(first));
+        second << " on";
+    }
+    vMessages = Take(pCapture);
+    CHECK(vMessages.size() == 1);
+    CHECK(vMessages.size() == 1 && vMessages[0] == "moved on\n");
+
+    //move assignment logs the message the target was building first
+    {
+        Stream first(Level::kInfo, "test");
+        first << "first";
+        Stream second(Level::kInfo, "test");
+        second << "second";
+        second = std::move(first);
+    }
+    vMessages = Take(pCapture);
+    CHECK(vMessages.size() == 2);
+    CHECK(vMessages.size() == 2 && vMessages[0] == "second\n" && vMessages[1] == "first\n");
+
+    //a logger's messages are only enabled if an output it routes to accepts them for its prefix
+    {
+        auto nOther = Stream::AddOutput(std::make_unique<Capture>());
+        Stream::SetOutputLevel(Level::kInfo);
+        Stream::SetOutputLevel(nCapture, Prefix("elsewhere"), Level::kTrace);
+        Stream::SetOutputLevel(nOther, Prefix("routed"), Level::kTrace);
+
+        Logger logger("routed");
+        logger.RouteTo({nCapture});
+        CHECK(Stream::IsEnabled(Level::kDebug, logger) == false);
+        CHECK(Stream::IsEnabled(Level::kInfo, logger));
+
+        auto bCalled = false;
+        logger.debug().lazy([&]{ bCalled = true; return 1; });
+        CHECK(bCalled == false);
+
+        Stream::RemoveOutput(nOther);
+        logger.RouteToAll();
+        Stream::SetOutputLevel(Level::kTrace);
+        Take(pCapture);
+    }
+
+    //routes work for any number of outputs
+    {
+        std::vector<std::pair<size_t, Capture*>> vOutputs;
+        for(size_t i = 0; i < 70; i++)
+        {
+            auto pOutput = std::make_unique<Capture>();
+            auto pRaw = pOutput.get();
+            vOutputs.emplace_back(Stream::AddOutput(std::move(pOutput)), pRaw);
+        }
+
+        Logger logger("many");
+        logger.RouteTo({vOutputs.back().first});
+        logger.info() << "last only";
+        Take(pCapture);
+        CHECK(vOutputs.back().second->vMessages.size() == 1);
+        CHECK(vOutputs[64].second->vMessages.empty());
+        CHECK(vOutputs[0].second->vMessages.empty());
+
+        for(const auto& pairOutput : vOutputs)
+        {
+            Stream::RemoveOutput(pairOutput.first);
+        }
+    }
+
+    //once every logger id is in use a new name is not registered and leaves the default logger alone
+    {
+        std::vector<Logger> vLoggers;
+        for(size_t i = 0; i < Logger::kMaxLoggers; i++)
+        {
+            vLoggers.emplace_back("logger"+std::to_string(i));
+        }
+        CHECK(vLoggers.back().IsRegistered() == false);
+        vLoggers.back().SetLevel(Level::kCritical);
+        info("test") << "default";
+        CHECK(Take(pCapture).size() == 1);
+    }
+
+    Stream::Stop();
+    return g_nFailures;
+}
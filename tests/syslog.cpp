@@ -0,0 +1,166 @@
+#include "logtosyslog.h"
+#include "check.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace pml::log;
+
+/** @brief a Unix datagram socket standing in for the syslog daemon or journald
+**/
+class Daemon
+{
+    public:
+        explicit Daemon(const std::string& sPath) : m_sPath(sPath)
+        {
+            m_nSocket = socket(AF_UNIX, SOCK_DGRAM, 0);
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            strncpy(address.sun_path, m_sPath.c_str(), sizeof(address.sun_path)-1);
+            bind(m_nSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+
+            timeval timeout{2, 0};
+            setsockopt(m_nSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        }
+        ~Daemon()
+        {
+            close(m_nSocket);
+            unlink(m_sPath.c_str());
+        }
+
+        /** @brief returns the next datagram or an empty string if none arrives in time
+        **/
+        std::string Receive()
+        {
+            char aBuffer[4096];
+            auto nLength = recv(m_nSocket, aBuffer, sizeof(aBuffer), 0);
+            return nLength > 0 ? std::string(aBuffer, static_cast<size_t>(nLength)) : std::string();
+        }
+
+    private:
+        std::string m_sPath;
+        int m_nSocket = -1;
+};
+
+static std::vector<std::string> Split(const std::string& sDatagram, size_t nFields)
+{
+    std::vector<std::string> vFields;
+    size_t nStart = 0;
+    while(vFields.size()+1 < nFields)
+    {
+        auto nEnd = sDatagram.find(' ', nStart);
+        if(nEnd == std::string::npos)
+        {
+            break;
+        }
+        vFields.push_back(sDatagram.substr(nStart, nEnd-nStart));
+        nStart = nEnd+1;
+    }
+    vFields.push_back(sDatagram.substr(nStart));
+    return vFields;
+}
+
+static bool HasField(const std::string& sDatagram, const std::string& sField)
+{
+    return sDatagram.compare(0, sField.size()+1, sField+"\n") == 0 || sDatagram.find("\n"+sField+"\n") != std::string::npos;
+}
+
+int main()
+{
+    char sDir[] = "/tmp/pml_log_test_XXXXXX";
+    if(mkdtemp(sDir) == nullptr)
+    {
+        std::cout << "Could not create temporary directory" << std::endl;
+        return 1;
+    }
+    Daemon syslogd(std::string(sDir)+"/log");
+    Daemon journald(std::string(sDir)+"/journal");
+
+    Stream::AddOutput(std::make_unique<Syslog>(Syslog::Protocol::kSyslog, "pml_test", 1, std::string(sDir)+"/log"));
+    Stream::AddOutput(std::make_unique<Syslog>(Syslog::Protocol::kJournald, "pml_test", 1, std::string(sDir)+"/journal"));
+
+    //RFC 5424: <PRI>VERSION TIMESTAMP HOSTNAME APP-NAME PROCID MSGID STRUCTURED-DATA MSG with one message per datagram
+    info("net") << "hello" << std::endl;
+    error() << "second";
+    Stream::FlushAll();
+
+    auto vFields = Split(syslogd.Receive(), 8);
+    CHECK(vFields.size() == 8);
+    if(vFields.size() == 8)
+    {
+        CHECK(vFields[0] == "<14>1");
+        CHECK(vFields[1].size() == 27 && vFields[1][10] == 'T' && vFields[1].back() == 'Z');
+        CHECK(vFields[2].empty() == false);
+        CHECK(vFields[3] == "pml_test");
+        CHECK(vFields[4] == std::to_string(getpid()));
+        CHECK(vFields[5] == "net");
+        CHECK(vFields[6] == "-");
+        CHECK(vFields[7] == "hello");
+    }
+    vFields = Split(syslogd.Receive(), 8);
+    CHECK(vFields.size() == 8 && vFields[0] == "<11>1" && vFields[5] == "-" && vFields[7] == "second");
+
+    //MSGID is at most 32 printable US-ASCII characters
+    info("a prefix with spaces, \xC3\xA9 and more than thirty two characters") << "msgid";
+    Stream::FlushAll();
+    vFields = Split(syslogd.Receive(), 8);
+    CHECK(vFields.size() == 8 && vFields[7] == "msgid");
+    if(vFields.size() == 8)
+    {
+        CHECK(vFields[5].size() == 32);
+        for(auto c : vFields[5])
+        {
+            CHECK(c >= 33 && c <= 126);
+        }
+    }
+
+    //journald: one FIELD=value per line, and a multi-line value as the name, a little-endian 64 bit length and the data
+    auto sDatagram = journald.Receive();
+    CHECK(HasField(sDatagram, "PRIORITY=6"));
+    CHECK(HasField(sDatagram, "SYSLOG_FACILITY=1"));
+    CHECK(HasField(sDatagram, "SYSLOG_IDENTIFIER=pml_test"));
+    CHECK(HasField(sDatagram, "PML_LOG_PREFIX=net"));
+    std::string sExpected = "\nMESSAGE=hello\n";
+    CHECK(sDatagram.size() > sExpected.size() && sDatagram.compare(sDatagram.size()-sExpected.size(), sExpected.size(), sExpected) == 0);
+
+    sDatagram = journald.Receive();
+    CHECK(HasField(sDatagram, "PRIORITY=3"));
+    CHECK(sDatagram.find("PML_LOG_PREFIX=") == std::string::npos);
+    journald.Receive();
+
+    info("net") << "line one\nline two";
+    Stream::FlushAll();
+    syslogd.Receive();
+    sDatagram = journald.Receive();
+    std::string sMessage = "line one\nline two";
+    sExpected = "\nMESSAGE\n";
+    for(int i = 0; i < 8; i++)
+    {
+        sExpected += static_cast<char>((uint64_t(sMessage.size()) >> (i*8)) & 0xFF);
+    }
+    sExpected += sMessage+"\n";
+    CHECK(sDatagram.size() > sExpected.size() && sDatagram.compare(sDatagram.size()-sExpected.size(), sExpected.size(), sExpected) == 0);
+
+    //a missing socket drops the messages and counts them without holding up the Manager thread
+    auto pMissing = std::make_unique<Syslog>(Syslog::Protocol::kSyslog, "pml_test", 1, std::string(sDir)+"/missing");
+    auto pRaw = pMissing.get();
+    auto nMissing = Stream::AddOutput(std::move(pMissing));
+    info() << "nowhere";
+    Stream::FlushAll();
+    CHECK(pRaw->GetDropped() == 1);
+    Stream::RemoveOutput(nMissing);
+    syslogd.Receive();
+    journald.Receive();
+
+    Stream::Stop();
+    rmdir(sDir);
+    return g_nFailures;
+}